@@ -95,6 +95,7 @@ typedef struct compiler_invocation {
     /* options */
     bool page_align;                        /* default: true */
     const char *start_entry_name;           /* default: _start */
+    const char *symbol_map_path;            /* default: NULL (no symbol map) */
 } compiler_invocation_t;
 
 #endif /* LA64ASM_TYPE_H */
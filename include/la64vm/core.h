@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 #pragma mark - opcode
 
@@ -87,8 +88,13 @@
 #define LA64_OPCODE_BL              0b00101110
 #define LA64_OPCODE_RET             0b00101111
 #define LA64_OPCODE_IRET            0b00110000
+#define LA64_OPCODE_MFB             0b00110001
+#define LA64_OPCODE_MTB             0b00110010
 
-#define LA64_OPCODE_MAX             LA64_OPCODE_IRET
+/* memory management operations */
+#define LA64_OPCODE_TLBI            0b00110011
+
+#define LA64_OPCODE_MAX             LA64_OPCODE_TLBI
 
 #pragma mark - parameter modes
 
@@ -182,9 +188,9 @@
 #define LA64_REGISTER_CR1   0b10111 /* CRKSP:   kernel stack pointer (the stack pointer the interrupt controller will use when receiving interrupt) */
 #define LA64_REGISTER_CR2   0b11000 /* CREXC:   exception register (first 3bits for the exception) */
 #define LA64_REGISTER_CR3   0b11001 /* CRVEC:   cpu vector table */
-#define LA64_REGISTER_CR4   0b11010 /* CRPTB:   page table pointer (first 8bits are the flags and the rest is the physical address where the page table is) */
-#define LA64_REGISTER_CR5   0b11011
-#define LA64_REGISTER_CR6   0b11100
+#define LA64_REGISTER_CR4   0b11010 /* CRPTB:   page table pointer (first 8bits are the flags and the asid, the rest is the physical address where the page table is) */
+#define LA64_REGISTER_CR5   0b11011 /* CRFAR:   fault address register (virtual address of the last page fault) */
+#define LA64_REGISTER_CR6   0b11100 /* CRFSR:   fault status register (access type, present and user bits of the last page fault) */
 #define LA64_REGISTER_CR7   0b11101
 #define LA64_REGISTER_CR8   0b11110
 #define LA64_REGISTER_CR9   0b11111
@@ -250,14 +256,40 @@
  */
 #define LA64_EXCEPTION_BAD_ARITHMETIC    0b100
 
+/*
+ * the mmu refused a translation, CR5 and CR6 tell
+ * where and why. unlike the others the faulting
+ * instruction did not retire, iret runs it again
+ * so the handler can map the page and carry on.
+ */
+#define LA64_EXCEPTION_PAGE_FAULT        0b101
+
 typedef struct la64_machine la64_machine_t;
 typedef struct la64_operation la64_operation_t;
 
+/* translation cache, direct mapped on the 8K virtual page number */
+#define LA64_TLB_ENTRIES    256
+
+typedef struct {
+    uint64_t vpn;       /* virtual address >> 13 */
+    uint64_t frame;     /* physical address of the 8K frame */
+    uint8_t flags;      /* flags of the leaf entry it came from */
+    uint8_t asid;
+    bool global;
+    bool valid;
+} la64_tlb_entry_t;
+
 typedef struct la64_core {
 
     /* the pthread this core is running on on the host */
     pthread_t pthread;
 
+    /*
+     * asks the execution loop to leave after the current
+     * instruction, from the core it self or any other thread.
+     */
+    atomic_bool stop;
+
     /* a array of all (control) registers */
     uint64_t rl[LA64_REGISTER_MAX + 1];
 
@@ -309,11 +341,33 @@ typedef struct la64_core {
     bool unhalted_interrupt;
 
     /*
-     * cpu cant get a second interrupt while handling
-     * one, but will be unset when the cpu calls iret.
+     * set while any handler runs, only a higher priority
+     * line can interrupt it and only with nesting enabled,
+     * unset when the cpu calls iret on the outermost one.
      */
     bool in_interrupt;
 
+    /*
+     * shadow register bank, with banked interrupts the
+     * outermost entry swaps pc up to cr0 with it and iret
+     * swaps them back, mfb and mtb reach the other bank.
+     */
+    uint64_t shadow[LA64_REGISTER_CR0 + 1];
+
+    /*
+     * set by the mmu when a translation faults, the
+     * core then rolls the instruction back instead of
+     * retiring it.
+     */
+    bool page_fault;
+
+    /*
+     * translations tagged by address space, the crptb they
+     * were made under tells if the tables moved under an asid.
+     */
+    la64_tlb_entry_t tlb[LA64_TLB_ENTRIES];
+    uint64_t tlb_ptb;
+
     /* pointer back to machine */
     la64_machine_t *machine;
 
@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_DEVICE_BALLOON_H
+#define LA64VM_DEVICE_BALLOON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <la64vm/core.h>
+
+#define LA64_BALLOON_BASE       0x1FE90000
+#define LA64_BALLOON_SIZE       0x30
+
+#define BALLOON_REG_LIST        0x00    /* physical address of the report list */
+#define BALLOON_REG_COUNT       0x08    /* write n to hand back the first n ranges of the list */
+#define BALLOON_REG_RETURNED    0x10    /* read only, pages given back to the host so far */
+#define BALLOON_REG_REJECTED    0x18    /* read only, ranges that could not be given back */
+#define BALLOON_REG_TARGET      0x20    /* read only, pages the host would like the guest to give up */
+#define BALLOON_REG_CTRL        0x28
+
+#define BALLOON_CTRL_LAZY       (1 << 0)    /* let the host reclaim under pressure only (MADV_FREE) */
+
+#define BALLOON_MAX_RANGES      512         /* longer lists are rejected as a whole */
+
+/* reports live in guest ram, page aligned and page granular */
+typedef struct {
+    uint64_t addr;
+    uint64_t len;
+} la64_balloon_range_t;
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    uint64_t ctrl;
+    uint64_t list;
+    uint64_t returned;
+    uint64_t rejected;
+    uint64_t target;
+    la64_machine_t *machine;
+} la64_balloon_t;
+
+la64_balloon_t *la64_balloon_alloc(la64_machine_t *machine);
+void la64_balloon_dealloc(la64_balloon_t *balloon);
+
+uint64_t la64_balloon_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_balloon_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_BALLOON_H */
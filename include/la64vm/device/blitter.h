@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LA64VM_DEVICE_BLITTER_H
+#define LA64VM_DEVICE_BLITTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <la64vm/core.h>
+
+#define LA64_BLIT_BASE          0x1FE30000
+#define LA64_BLIT_SIZE          0x30
+
+#define BLIT_REG_CTRL           0x00
+#define BLIT_REG_RING_BASE      0x08    /* physical address of the descriptor ring */
+#define BLIT_REG_RING_SIZE      0x10    /* descriptors in the ring, power of two */
+#define BLIT_REG_HEAD           0x18    /* read only, next descriptor the blitter consumes */
+#define BLIT_REG_TAIL           0x20    /* doorbell, one past the last descriptor the guest queued */
+#define BLIT_REG_STATUS         0x28
+
+#define BLIT_CTRL_ENABLE        (1 << 0)
+#define BLIT_CTRL_IRQ_EN        (1 << 1)    /* raise LA64_IRQ_BLITTER when the ring drained */
+
+#define BLIT_STATUS_BUSY        (1 << 0)
+#define BLIT_STATUS_DONE        (1 << 1)    /* write 1 to clear */
+#define BLIT_STATUS_ERROR       (1 << 2)    /* write 1 to clear */
+
+/* operations */
+#define BLIT_OP_FILL            1   /* dst = src & 0xFF */
+#define BLIT_OP_COPY            2   /* dst = src, overlapping rects are fine */
+#define BLIT_OP_KEYED           3   /* dst = src where src != key */
+#define BLIT_OP_REMAP           4   /* dst = table[src], src may equal dst */
+
+/* written back into the descriptor */
+#define BLIT_DESC_DONE          1
+#define BLIT_DESC_ERROR         2
+
+/*
+ * descriptors live in guest ram, surfaces are 8 bit indexed
+ * and addressed physically by their top left pixel, so the
+ * framebuffer and any off screen surface in ram look alike.
+ */
+typedef struct {
+    uint32_t op;
+    uint32_t key;
+    uint32_t width;
+    uint32_t height;
+    uint64_t src;
+    uint64_t src_pitch;
+    uint64_t dst;
+    uint64_t dst_pitch;
+    uint64_t table;
+    uint64_t status;
+} la64_blit_desc_t;
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    uint64_t ctrl;
+    uint64_t ring_base;
+    uint64_t ring_size;
+    atomic_uint_fast64_t head;
+    atomic_uint_fast64_t tail;
+    atomic_uint_fast64_t status;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    atomic_bool running;
+
+    la64_machine_t *machine;
+} la64_blitter_t;
+
+la64_blitter_t *la64_blitter_alloc(la64_machine_t *machine);
+void la64_blitter_dealloc(la64_blitter_t *blitter);
+
+uint64_t la64_blitter_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_blitter_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_BLITTER_H */
@@ -0,0 +1,162 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef LA64VM_DEVICE_DISK_H
+#define LA64VM_DEVICE_DISK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <la64vm/core.h>
+#include <la64vm/ioloop.h>
+
+#define LA64_DISK_BASE          0x1FE40000
+#define LA64_DISK_SIZE          0x40
+
+#define DISK_REG_CTRL           0x00
+#define DISK_REG_RING_BASE      0x08    /* physical address of the descriptor ring */
+#define DISK_REG_RING_SIZE      0x10    /* descriptors in the ring, power of two */
+#define DISK_REG_HEAD           0x18    /* read only, next descriptor the disk takes */
+#define DISK_REG_TAIL           0x20    /* doorbell, one past the last descriptor the guest queued */
+#define DISK_REG_STATUS         0x28
+#define DISK_REG_CAPACITY       0x30    /* read only, image size in sectors */
+#define DISK_REG_INFLIGHT       0x38    /* read only, requests taken but not completed */
+
+#define DISK_CTRL_ENABLE        (1 << 0)
+#define DISK_CTRL_IRQ_EN        (1 << 1)    /* raise LA64_IRQ_DISK when requests complete */
+
+#define DISK_STATUS_BUSY        (1 << 0)
+#define DISK_STATUS_DONE        (1 << 1)    /* write 1 to clear */
+#define DISK_STATUS_ERROR       (1 << 2)    /* write 1 to clear */
+
+#define DISK_SECTOR_SIZE        512
+
+/* operations */
+#define DISK_OP_READ            1   /* image -> guest ram */
+#define DISK_OP_WRITE           2   /* guest ram -> image */
+#define DISK_OP_FLUSH           3   /* everything completed so far hits the host storage */
+
+/* written back into the descriptor */
+#define DISK_DESC_DONE          1
+#define DISK_DESC_ERROR         2
+
+/* requests the host keeps in flight at once, the rest waits in the ring */
+#ifndef DISK_MAX_INFLIGHT
+#define DISK_MAX_INFLIGHT       64
+#endif /* DISK_MAX_INFLIGHT */
+
+#define DISK_WORKERS            4
+
+/*
+ * descriptors live in guest ram and complete out of order,
+ * a slot may only be reused once its status is non zero.
+ */
+typedef struct {
+    uint32_t op;
+    uint32_t count;     /* sectors */
+    uint64_t sector;
+    uint64_t addr;      /* guest physical buffer */
+    uint64_t status;
+} la64_disk_desc_t;
+
+typedef struct la64_disk_req {
+    uint64_t desc;      /* where the status goes */
+    uint32_t op;
+    uint64_t addr;      /* guest buffer, reads mark it dirty once done */
+    uint64_t offset;
+    struct iovec iov;
+    struct la64_disk_req *next;
+} la64_disk_req_t;
+
+typedef struct la64_machine la64_machine_t;
+
+#if defined(__linux__)
+typedef struct {
+    int fd;
+    int efd;            /* completion eventfd, watched by the io loop */
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} la64_disk_uring_t;
+#endif /* __linux__ */
+
+typedef struct {
+    uint64_t ctrl;
+    uint64_t ring_base;
+    uint64_t ring_size;
+    atomic_uint_fast64_t head;
+    atomic_uint_fast64_t tail;
+    atomic_uint_fast64_t status;
+    atomic_uint_fast64_t inflight;
+
+    /* host image */
+    int fd;
+    uint64_t capacity;
+
+    /* guards the request pool and the submission side */
+    pthread_mutex_t mutex;
+    la64_disk_req_t reqs[DISK_MAX_INFLIGHT];
+    la64_disk_req_t *free;
+
+#if defined(__linux__)
+    bool uring;
+    la64_disk_uring_t ring;
+    la64_ioloop_source_t *uring_source;
+#endif /* __linux__ */
+
+    /* thread pool fallback */
+    pthread_t workers[DISK_WORKERS];
+    int nworkers;
+    pthread_cond_t cond;
+    la64_disk_req_t *queue;
+    la64_disk_req_t *queue_tail;
+    bool running;
+
+    la64_machine_t *machine;
+} la64_disk_t;
+
+la64_disk_t *la64_disk_alloc(la64_machine_t *machine);
+void la64_disk_dealloc(la64_disk_t *disk);
+
+bool la64_disk_attach(la64_disk_t *disk, const char *path);
+
+uint64_t la64_disk_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_disk_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_DISK_H */
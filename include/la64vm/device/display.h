@@ -40,30 +40,116 @@
 #define LA64_FB_REG_ENABLED 0x00
 #define LA64_FB_PALLETE     0x01
 #define LA64_FB_FRAMEBUFFER 0x301
+#define LA64_FB_BACKBUFFER  (LA64_FB_FRAMEBUFFER + (LA64_FB_WIDTH * LA64_FB_HEIGHT))
+#define LA64_FB_REG_FLIP    (LA64_FB_BACKBUFFER + (LA64_FB_WIDTH * LA64_FB_HEIGHT))    /* buffer scanned out from the next vblank on, reads back the current one */
+#define LA64_FB_REG_VBLANK  (LA64_FB_REG_FLIP + 0x08)                                  /* read only, vblanks since boot */
+#define LA64_FB_REG_IRQ     (LA64_FB_REG_FLIP + 0x10)                                  /* 1 raises LA64_IRQ_DISPLAY on every vblank */
 
 #define LA64_FB_BASE        0x1FE00700
-#define LA64_FB_SIZE        LA64_FB_FRAMEBUFFER + (LA64_FB_WIDTH * LA64_FB_HEIGHT)
+#define LA64_FB_SIZE        (LA64_FB_REG_FLIP + 0x18)
+
+/*
+ * only the registers go through the MMIO callbacks, palette
+ * and both framebuffers are plain ram the guest stores into
+ * and the display thread reads from directly.
+ */
+#define LA64_FB_REG_SIZE    LA64_FB_PALLETE
+#define LA64_FB_RAM_BASE    (LA64_FB_BASE + LA64_FB_PALLETE)
+#define LA64_FB_RAM_SIZE    (LA64_FB_REG_FLIP - LA64_FB_PALLETE)
+#define LA64_FB_SCAN_BASE   (LA64_FB_BASE + LA64_FB_REG_FLIP)
+#define LA64_FB_SCAN_SIZE   (LA64_FB_SIZE - LA64_FB_REG_FLIP)
+
+/*
+ * stores into the ram mark 256 byte chunks dirty, which lines
+ * up with the rows of both buffers as the palette is exactly
+ * three chunks long.
+ */
+#define LA64_FB_DIRTY_SHIFT     8
+#define LA64_FB_DIRTY_CHUNKS    (LA64_FB_RAM_SIZE >> LA64_FB_DIRTY_SHIFT)
+#define LA64_FB_DIRTY_PALETTE   0
+#define LA64_FB_DIRTY_ROW(b, y) ((((b) ? LA64_FB_BACKBUFFER : LA64_FB_FRAMEBUFFER) - LA64_FB_PALLETE) / LA64_FB_WIDTH + (y))
+
+/* bits of the enabled register */
+#define LA64_FB_CTRL_ENABLE 0b00000001
+#define LA64_FB_CTRL_DUMP   0b00000010  /* headless only, requests a frame dump without touching the enable state */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <pthread.h>
+#include <stdatomic.h>
+
+#include <la64vm/ioloop.h>
 
 typedef struct la64_core la64_core_t;
 typedef struct la64_machine la64_machine_t;
 
 typedef struct {
     uint8_t enabled;
-    uint8_t *palette;
-    uint8_t *fb;
+    uint8_t *ram;
+    uint8_t *palette;   /* points into ram */
+    uint8_t *fb;        /* points into ram */
+    uint8_t *back;      /* points into ram */
     pthread_t pthread;
+
+    /* consumed by the display threads */
+    atomic_uchar dirty[LA64_FB_DIRTY_CHUNKS];
+
+    /* scanout */
+    atomic_uint front;
+    uint8_t flip;
+    uint8_t irq;
+    uint64_t vblank_cnt;
+    uint64_t vblank_interval;
+    uint64_t next_vblank;
+    la64_machine_t *machine;
+
+    /*
+     * headless displays never open a window, instead the
+     * io loop writes palette resolved frames to
+     * <dump_prefix>NNNNNN.ppm every dump_interval_ms
+     * (0 means only on request).
+     */
+    bool headless;
+    const char *dump_prefix;
+    uint64_t dump_interval_ms;
+    uint64_t dump_cnt;
+    atomic_bool dump_request;
+    uint8_t *dump_rgb;
+    la64_ioloop_source_t *dump_event;
+    la64_ioloop_source_t *dump_timer;
 } la64_display_t;
 
 la64_display_t *la64_display_alloc(la64_machine_t *machine);
 void la64_display_dealloc(la64_display_t *display);
 
+void la64_display_request_dump(la64_display_t *display);
+
+void la64_display_vblank(la64_display_t *display, uint64_t host_cycles);
+int la64_display_take_dirty_rows(la64_display_t *display, unsigned buffer, bool all, int *y);
+bool la64_display_take_dirty_palette(la64_display_t *display);
+
+static inline uint8_t *la64_display_buffer(la64_display_t *display,
+                                           unsigned buffer)
+{
+    return buffer ? display->back : display->fb;
+}
+
+static inline void la64_display_tick(la64_display_t *display,
+                                     uint64_t host_cycles)
+{
+    /* one compare per instruction until the next vblank is due */
+    if(host_cycles >= display->next_vblank)
+    {
+        la64_display_vblank(display, host_cycles);
+    }
+}
+
 void *display_start(void *arg);
 
 uint64_t la64_fb_read(la64_core_t *core, void *device, uint64_t offset, int size);
 void la64_fb_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+uint64_t la64_fb_scan_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_fb_scan_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
 
 #endif /* __linux__ | __APPLE__ */
 
@@ -81,6 +167,7 @@ void la64_fb_write(la64_core_t *core, void *device, uint64_t offset, uint64_t va
     GLuint _prog;
     GLuint _vao, _vbo, _ebo;
     GLuint _texIndex, _texPal;
+    unsigned _shown;
 
     NSTimer *_timer;
 }
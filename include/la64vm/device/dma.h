@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef LA64VM_DEVICE_DMA_H
+#define LA64VM_DEVICE_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <la64vm/core.h>
+
+#define LA64_DMA_BASE           0x1FE60000
+#define LA64_DMA_CHANNELS       4
+#define LA64_DMA_CHANNEL_SIZE   0x20
+#define LA64_DMA_SIZE           (LA64_DMA_CHANNELS * LA64_DMA_CHANNEL_SIZE)
+
+/* per channel, at channel * LA64_DMA_CHANNEL_SIZE */
+#define DMA_REG_CTRL            0x00
+#define DMA_REG_CHAIN           0x08    /* physical address of the first descriptor */
+#define DMA_REG_STATUS          0x10
+#define DMA_REG_COMPLETED       0x18    /* read only, descriptors finished since the last start */
+
+#define DMA_CTRL_START          (1 << 0)    /* write only, runs the chain at DMA_REG_CHAIN */
+#define DMA_CTRL_IRQ_EN         (1 << 1)    /* raise LA64_IRQ_DMA when the chain ends */
+#define DMA_CTRL_ABORT          (1 << 2)    /* write only, stops after the current descriptor */
+
+#define DMA_STATUS_BUSY         (1 << 0)
+#define DMA_STATUS_DONE         (1 << 1)    /* write 1 to clear */
+#define DMA_STATUS_ERROR        (1 << 2)    /* write 1 to clear */
+
+/* descriptor flags */
+#define DMA_DESC_FILL           (1 << 0)    /* dst = src & 0xFF, for zeroing pages */
+#define DMA_DESC_IRQ            (1 << 1)    /* raise LA64_IRQ_DMA after this descriptor too */
+
+/* written back into the descriptor */
+#define DMA_DESC_DONE           1
+#define DMA_DESC_ERROR          2
+
+/* descriptors live in guest ram and chain through next, 0 ends the chain */
+typedef struct {
+    uint64_t src;
+    uint64_t dst;
+    uint64_t len;
+    uint32_t flags;
+    uint32_t status;
+    uint64_t next;
+} la64_dma_desc_t;
+
+typedef struct la64_machine la64_machine_t;
+typedef struct la64_dma la64_dma_t;
+
+typedef struct {
+    uint64_t ctrl;
+    uint64_t chain;
+    atomic_uint_fast64_t status;
+    atomic_uint_fast64_t completed;
+    atomic_bool abort;
+
+    /* every channel copies on its own host thread */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool pending;
+
+    la64_dma_t *dma;
+} la64_dma_channel_t;
+
+typedef struct la64_dma {
+    la64_dma_channel_t channels[LA64_DMA_CHANNELS];
+    atomic_bool running;
+    la64_machine_t *machine;
+} la64_dma_t;
+
+la64_dma_t *la64_dma_alloc(la64_machine_t *machine);
+void la64_dma_dealloc(la64_dma_t *dma);
+
+uint64_t la64_dma_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_dma_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_DMA_H */
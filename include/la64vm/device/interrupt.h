@@ -29,7 +29,8 @@
 #include <stdbool.h>
 
 #define LA64_INTC_BASE      0x1FE00000
-#define LA64_INTC_SIZE      0x30
+#define LA64_INTC_CORES     1
+#define LA64_INTC_SIZE      (0x80 + LA64_INTC_CORES * 8)
 
 #define LA64_IRQ_EXCEPTION  0
 #define LA64_IRQ_TIMER      1
@@ -37,7 +38,12 @@
 #define LA64_IRQ_DISK       3
 #define LA64_IRQ_NETWORK    4
 #define LA64_IRQ_SOFTWARE   5
-/* IRQ 6-63 available for user devices */
+#define LA64_IRQ_PMU        6
+#define LA64_IRQ_DISPLAY    7
+#define LA64_IRQ_BLITTER    8
+#define LA64_IRQ_DMA        9
+#define LA64_IRQ_SHM        10
+/* IRQ 11-63 available for user devices */
 
 #define LA64_IRQ_MAX        63
 
@@ -47,20 +53,43 @@
 #define LA64_INTC_REG_VECTOR    0x18
 #define LA64_INTC_REG_ACK       0x20
 #define LA64_INTC_REG_CURRENT   0x28
+#define LA64_INTC_REG_THRESHOLD 0x30    /* only priorities above it are delivered */
+#define LA64_INTC_REG_RUNNING   0x38    /* read only, priority of the innermost unacked handler */
+#define LA64_INTC_REG_PRIORITY  0x40    /* one byte per line up to 0x7F, 0 masks the line */
+#define LA64_INTC_REG_ROUTE     0x80    /* one mask per core, lines it may take */
+
+#define LA64_INTC_PRIO_MAX      15
+#define LA64_INTC_PRIO_DEFAULT  1
 
 /* control register bits */
 #define LA64_INTC_CTRL_ENABLE   (1 << 0)
 #define LA64_INTC_CTRL_NESTING  (1 << 1)
+#define LA64_INTC_CTRL_BANKED   (1 << 2)    /* outermost entry swaps register banks instead of stacking a frame */
 
 typedef struct la64_core la64_core_t;
 typedef struct la64_machine la64_machine_t;
 
+/* one entry per handler running, the innermost on top */
+typedef struct {
+    int64_t irq;
+    uint8_t priority;   /* 0 once acked, so it stops blocking */
+    bool banked;        /* entered by swapping to the shadow bank */
+} la64_intc_active_t;
+
 typedef struct la64_intc {
-    uint64_t pending;
+    uint64_t pending;   /* raised from device threads, only touched atomically */
     uint64_t enabled;
     uint64_t ctrl;
     uint64_t vector_base;
     int64_t  current_irq;
+
+    uint8_t priority[LA64_IRQ_MAX + 1];
+    uint64_t threshold;
+    uint64_t route[LA64_INTC_CORES];
+
+    /* with nesting a higher priority line preempts a running handler */
+    la64_intc_active_t active[LA64_INTC_PRIO_MAX + 1];
+    int depth;
 } la64_intc_t;
 
 la64_intc_t *la64_intc_alloc(la64_machine_t *machine);
@@ -69,6 +98,7 @@ void la64_intc_dealloc(la64_intc_t *intc);
 void la64_raise_interrupt(la64_machine_t *machine, int irq_line);
 void la64_clear_interrupt(la64_machine_t *machine, int irq_line);
 bool la64_serve_interrupt_if_needed(la64_core_t *core);
+bool la64_intc_complete(la64_intc_t *intc);
 
 uint64_t la64_intc_read(la64_core_t *core, void *device, uint64_t offset, int size);
 void la64_intc_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
@@ -28,7 +28,14 @@
 #include <stdint.h>
 
 #define LA64_MC_BASE        0x1FE00400
-#define LA64_MC_SIZE        0x08
+#define LA64_MC_SIZE        0xD0
+
+#define LA64_MC_REG_SIZE        0x00    /* size of the main block at 0 */
+#define LA64_MC_REG_REGIONS     0x08    /* count of extra ram regions */
+#define LA64_MC_REG_REGION      0x10    /* base, size and flags of each region, 0x18 apart */
+
+#define LA64_MC_REGION_STRIDE   0x18
+#define LA64_MC_REGION_PERSISTENT   (1 << 0)
 
 typedef struct la64_core la64_core_t;
 
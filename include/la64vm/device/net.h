@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef LA64VM_DEVICE_NET_H
+#define LA64VM_DEVICE_NET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/un.h>
+#include <la64vm/core.h>
+#include <la64vm/ioloop.h>
+
+#define LA64_NET_BASE           0x1FE50000
+#define LA64_NET_SIZE           0x60
+
+#define NET_REG_CTRL            0x00
+#define NET_REG_TX_RING_BASE    0x08    /* physical address of the transmit ring */
+#define NET_REG_TX_RING_SIZE    0x10    /* descriptors in the ring, power of two */
+#define NET_REG_TX_HEAD         0x18    /* read only, next descriptor the device sends */
+#define NET_REG_TX_TAIL         0x20    /* doorbell, one past the last frame the guest queued */
+#define NET_REG_RX_RING_BASE    0x28    /* physical address of the receive ring */
+#define NET_REG_RX_RING_SIZE    0x30    /* descriptors in the ring, power of two */
+#define NET_REG_RX_HEAD         0x38    /* read only, next buffer the device fills */
+#define NET_REG_RX_TAIL         0x40    /* one past the last empty buffer the guest posted */
+#define NET_REG_STATUS          0x48
+#define NET_REG_IRQ_DELAY       0x50    /* microseconds completions are gathered before interrupting, 0 interrupts at once */
+#define NET_REG_RX_DROPS        0x58    /* read only, frames lost to a broken receive ring */
+
+#define NET_CTRL_ENABLE         (1 << 0)
+#define NET_CTRL_IRQ_EN         (1 << 1)    /* raise LA64_IRQ_NETWORK on completions */
+
+#define NET_STATUS_TX_DONE      (1 << 0)    /* write 1 to clear */
+#define NET_STATUS_RX_DONE      (1 << 1)    /* write 1 to clear */
+#define NET_STATUS_ERROR        (1 << 2)    /* write 1 to clear */
+#define NET_STATUS_LINK         (1 << 3)    /* read only, a backend is attached */
+
+/* written back into the descriptor */
+#define NET_DESC_DONE           1
+#define NET_DESC_ERROR          2   /* send failed or the frame did not fit the buffer */
+
+#define NET_MAX_FRAME           65536
+#define NET_BATCH               32  /* frames per sendmmsg/recvmmsg */
+
+/*
+ * descriptors live in guest ram. for transmit len is the
+ * frame length, for receive it is the buffer size going in
+ * and the frame length coming back, so reposting a buffer
+ * means resetting len and status.
+ */
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint32_t flags;
+    uint64_t status;
+    uint64_t reserved;
+} la64_net_desc_t;
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    uint64_t ctrl;
+    uint64_t tx_ring_base;
+    uint64_t tx_ring_size;
+    atomic_uint_fast64_t tx_head;
+    atomic_uint_fast64_t tx_tail;
+    uint64_t rx_ring_base;
+    uint64_t rx_ring_size;
+    atomic_uint_fast64_t rx_head;
+    atomic_uint_fast64_t rx_tail;
+    atomic_uint_fast64_t status;
+    atomic_uint_fast64_t rx_drops;
+
+    /* interrupt mitigation, one interrupt until the guest acks STATUS */
+    uint32_t irq_delay;
+    atomic_bool irq_sent;
+    atomic_bool irq_timer_armed;
+    la64_ioloop_source_t *irq_timer;
+
+    /* unix datagram backend, frames go to peer */
+    int fd;
+    struct sockaddr_un local;
+    struct sockaddr_un peer;
+
+    /* receive runs on the io loop and parks while no buffers are posted */
+    la64_ioloop_source_t *rx_source;
+    atomic_bool rx_stalled;
+
+    /* transmit runs on its own thread since sends block on a full peer */
+    pthread_t tx_thread;
+    pthread_mutex_t tx_mutex;
+    pthread_cond_t tx_cond;
+    atomic_bool tx_running;
+
+    la64_machine_t *machine;
+} la64_net_t;
+
+la64_net_t *la64_net_alloc(la64_machine_t *machine);
+void la64_net_dealloc(la64_net_t *net);
+
+bool la64_net_attach(la64_net_t *net, const char *spec);
+
+uint64_t la64_net_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_net_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_NET_H */
@@ -28,9 +28,11 @@
 #include <stdint.h>
 
 #define LA64_PLATFORM_BASE  0x1FE00500
-#define LA64_PLATFORM_SIZE  0x01
+#define LA64_PLATFORM_SIZE  0x18
 
 #define PLATFORM_REG_PWR    0x00
+#define PLATFORM_REG_EXIT   0x08    /* status the host reports once the guest powered off */
+#define PLATFORM_REG_READY  0x10    /* write marks the fork point, reads the clone number (0 if not a clone) */
 
 typedef struct la64_core la64_core_t;
 
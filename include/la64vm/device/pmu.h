@@ -0,0 +1,99 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_DEVICE_PMU_H
+#define LA64VM_DEVICE_PMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <la64vm/core.h>
+
+#define LA64_PMU_BASE           0x1FE00600
+#define LA64_PMU_SIZE           0xB0
+
+/* countable events, each one owns the counter with the same index */
+#define LA64_PMU_EVENT_INSTRUCTIONS 0
+#define LA64_PMU_EVENT_BRANCHES     1
+#define LA64_PMU_EVENT_LOADS        2
+#define LA64_PMU_EVENT_STORES       3
+#define LA64_PMU_EVENT_TLB_MISSES   4
+#define LA64_PMU_EVENT_MMIO         5
+#define LA64_PMU_EVENT_INTERRUPTS   6
+
+#define LA64_PMU_COUNTERS           7
+
+#define PMU_REG_CTRL            0x00
+#define PMU_REG_OVERFLOW        0x08    /* write 1 to clear */
+#define PMU_REG_RESET           0x10    /* write only, mask of counters to zero */
+#define PMU_REG_COUNTER_CFG(n)  (0x40 + ((n) * 0x10))
+#define PMU_REG_COUNTER_VAL(n)  (0x48 + ((n) * 0x10))
+
+#define PMU_CTRL_ENABLE         (1 << 0)
+
+/*
+ * per counter configuration, the elevation bits select at
+ * which elevation events are counted, so the guest kernel
+ * can profile user space without counting it self.
+ */
+#define PMU_CFG_ENABLE          (1 << 0)
+#define PMU_CFG_IRQ_EN          (1 << 1)    /* raise LA64_IRQ_PMU when the counter wraps */
+#define PMU_CFG_EL_USER         (1 << 4)
+#define PMU_CFG_EL_KERNEL       (1 << 5)
+#define PMU_CFG_EL_SECURE       (1 << 6)
+#define PMU_CFG_EL_SHIFT        4
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct la64_pmu {
+    uint64_t ctrl;
+    uint64_t overflow;
+    uint64_t cfg[LA64_PMU_COUNTERS];
+    uint64_t count[LA64_PMU_COUNTERS];
+
+    /* events that count at each elevation, recalculated on every configuration write */
+    uint32_t active[4];
+
+    la64_machine_t *machine;
+} la64_pmu_t;
+
+la64_pmu_t *la64_pmu_alloc(la64_machine_t *machine);
+void la64_pmu_dealloc(la64_pmu_t *pmu);
+
+void la64_pmu_count(la64_pmu_t *pmu, uint8_t event);
+
+static inline void la64_pmu_event(la64_pmu_t *pmu,
+                                  la64_core_t *core,
+                                  uint8_t event)
+{
+    /* cheap enough to sit on every instruction */
+    if(pmu->active[core->rl[LA64_REGISTER_CR0] & 0b11] & (1u << event))
+    {
+        la64_pmu_count(pmu, event);
+    }
+}
+
+uint64_t la64_pmu_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_pmu_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_PMU_H */
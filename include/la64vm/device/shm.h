@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_DEVICE_SHM_H
+#define LA64VM_DEVICE_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/un.h>
+#include <la64vm/core.h>
+#include <la64vm/ioloop.h>
+
+#define LA64_SHM_BASE           0x1FE80000
+#define LA64_SHM_SIZE           0x30
+
+/* where the shared window shows up in guest physical memory */
+#define LA64_SHM_RAM_BASE       0x200000000
+
+#define SHM_REG_ID              0x00    /* read only, this vm's peer id */
+#define SHM_REG_RAM_BASE        0x08    /* read only, physical base of the shared window */
+#define SHM_REG_RAM_SIZE        0x10    /* read only, 0 while nothing is attached */
+#define SHM_REG_DOORBELL        0x18    /* write (peer << 8) | vector to interrupt a peer */
+#define SHM_REG_PENDING         0x20    /* vectors rung on this vm, write 1 to clear */
+#define SHM_REG_CTRL            0x28
+
+#define SHM_CTRL_IRQ_EN         (1 << 0)    /* raise LA64_IRQ_SHM while vectors are pending */
+
+#define SHM_MAX_PEERS           16
+#define SHM_MAX_VECTORS         64
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    uint64_t ctrl;
+    atomic_uint_fast64_t pending;
+
+    /* posix shared memory every peer maps under the same name */
+    uint8_t *ram;
+    uint64_t ram_size;
+
+    /* doorbells are datagrams between per peer unix sockets */
+    uint64_t id;
+    int fd;
+    char name[64];
+    struct sockaddr_un local;
+    la64_ioloop_source_t *source;
+
+    la64_machine_t *machine;
+} la64_shm_t;
+
+la64_shm_t *la64_shm_alloc(la64_machine_t *machine);
+void la64_shm_dealloc(la64_shm_t *shm);
+
+bool la64_shm_attach(la64_shm_t *shm, const char *spec);
+
+uint64_t la64_shm_read(la64_core_t *core, void *device, uint64_t offset, int size);
+void la64_shm_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
+
+#endif /* LA64VM_DEVICE_SHM_H */
@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#ifndef LA64VM_DEVICE_TIMEPAGE_H
+#define LA64VM_DEVICE_TIMEPAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LA64_TIMEPAGE_BASE      0x1FE70000
+#define LA64_TIMEPAGE_SIZE      0x1000
+
+/* how stale the counter may get, in nanoseconds */
+#ifndef LA64_TIMEPAGE_RES_NS
+#define LA64_TIMEPAGE_RES_NS    1000
+#endif /* LA64_TIMEPAGE_RES_NS */
+
+/*
+ * guest visible, read only. guests read seq, the fields,
+ * then seq again and retry while it was odd or changed.
+ * wall clock time is wall_sec/wall_nsec plus counter / freq.
+ */
+typedef struct {
+    uint64_t seq;               /* odd while the host is writing */
+    uint64_t counter;           /* host cycles since the machine came up */
+    uint64_t freq;              /* counter ticks per second, same as TIMER_REG_FREQ */
+    uint64_t wall_sec;          /* unix time at counter 0 */
+    uint64_t wall_nsec;
+    uint64_t resolution_ns;     /* how often counter is refreshed */
+} la64_timepage_data_t;
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    uint8_t *ram;
+    la64_timepage_data_t *data;
+
+    uint64_t boot_cycles;
+    uint64_t interval;          /* host cycles between counter refreshes */
+    uint64_t next_update;
+    uint64_t next_wall;         /* the wall clock base follows host adjustments once a second */
+} la64_timepage_t;
+
+la64_timepage_t *la64_timepage_alloc(la64_machine_t *machine);
+void la64_timepage_dealloc(la64_timepage_t *tp);
+
+void la64_timepage_update(la64_timepage_t *tp, uint64_t host_cycles);
+void la64_timepage_rebase(la64_timepage_t *tp, uint64_t boot_cycles);
+
+static inline void la64_timepage_tick(la64_timepage_t *tp,
+                                      uint64_t host_cycles)
+{
+    /* one compare per instruction until the next refresh is due */
+    if(host_cycles >= tp->next_update)
+    {
+        la64_timepage_update(tp, host_cycles);
+    }
+}
+
+#endif /* LA64VM_DEVICE_TIMEPAGE_H */
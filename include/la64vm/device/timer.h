@@ -26,16 +26,22 @@
 #define LA64VM_DEVICE_TIMER_H
 
 #include <stdint.h>
+#include <pthread.h>
 #include <la64vm/core.h>
+#include <la64vm/ioloop.h>
 
 #define LA64_TIMER_BASE     0x1FE00100
-#define LA64_TIMER_SIZE     0x28
+#define LA64_TIMER_CHANNELS 4
+#define LA64_TIMER_CHANNEL_SIZE 0x40
+#define LA64_TIMER_SIZE     (LA64_TIMER_CHANNELS * LA64_TIMER_CHANNEL_SIZE)
 
+/* per channel, at channel * LA64_TIMER_CHANNEL_SIZE, channel 0 is the original timer */
 #define TIMER_REG_CTRL      0x00
 #define TIMER_REG_COUNT     0x08
 #define TIMER_REG_COMPARE   0x10
 #define TIMER_REG_STATUS    0x18
 #define TIMER_REG_FREQ      0x20        /* read only!!! */
+#define TIMER_REG_PENDING   0x28        /* read only, bit n set while channel n has TIMER_STATUS_IRQ */
 
 #define TIMER_CTRL_ENABLE   (1 << 0)
 #define TIMER_CTRL_IRQ_EN   (1 << 1)
@@ -44,23 +50,51 @@
 
 typedef struct la64_machine la64_machine_t;
 
-typedef struct la64_timer {
+/*
+ * counts are never ticked, a running channel is worth
+ * count + (host cycles - base_cycles) whenever someone
+ * looks, and its compare match is a deadline in host
+ * cycles.
+ */
+typedef struct {
     uint64_t ctrl;
     uint64_t count;
+    uint64_t base_cycles;
     uint64_t compare;
     uint64_t status;
-    
+    uint64_t deadline;
+    int heap_index;     /* -1 while no match is due */
+} la64_timer_channel_t;
+
+typedef struct la64_timer {
+    la64_timer_channel_t channels[LA64_TIMER_CHANNELS];
+
+    /* channels ordered by deadline, the earliest one arms the host timer */
+    int heap[LA64_TIMER_CHANNELS];
+    int heap_len;
+
+    /*
+     * guards the channels and the heap, the expiry callback
+     * takes it under the loop mutex, mmio takes it alone.
+     */
+    pthread_mutex_t mutex;
+
+    /* matches fire on the loop */
+    la64_ioloop_source_t *source;
+
     uint64_t host_freq;
-    uint64_t last_host_cycles;
-    
+    uint64_t min_period;    /* periodic matches are at least 1us apart, or the loop never catches up */
+
     la64_machine_t *machine;
 } la64_timer_t;
 
 la64_timer_t *la64_timer_alloc(la64_machine_t *core);
 void la64_timer_dealloc(la64_timer_t *timer);
-void la64_timer_tick(la64_timer_t *timer, uint64_t host_cycles);
 uint64_t la64_get_host_cycles(void);
 
+void la64_timer_save(la64_timer_t *timer, la64_timer_channel_t *channels);
+void la64_timer_restore(la64_timer_t *timer, const la64_timer_channel_t *channels);
+
 uint64_t la64_timer_read(la64_core_t *core, void *device, uint64_t offset, int size);
 void la64_timer_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
 
@@ -29,15 +29,26 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <stdatomic.h>
+#include <termios.h>
+
+#include <la64vm/ioloop.h>
 
 #define LA64_UART_BASE      0x1FE00300
-#define LA64_UART_SIZE      0x10
+#define LA64_UART_SIZE      0x18
+
+/* receive fifo depth, power of two, can be overridden at build time */
+#ifndef UART_BUF_SIZE
+#define UART_BUF_SIZE          4096
+#endif /* UART_BUF_SIZE */
 
-#define UART_BUF_SIZE          64
+#define UART_TX_BUF_SIZE       65536   /* power of two */
 
 #define UART_REG_DATA          0x00
 #define UART_REG_STATUS        0x04
 #define UART_REG_CONTROL       0x08
+#define UART_REG_RX_TRIGGER    0x0C    /* rx interrupt once this many bytes are queued */
+#define UART_REG_RX_TIMEOUT    0x10    /* microseconds of rx silence that interrupt below the trigger, 0 disables */
+#define UART_REG_RX_LEVEL      0x14    /* read only, bytes waiting in the rx fifo */
 
 #define UART_STATUS_RX_READY   (1 << 0)
 #define UART_STATUS_TX_EMPTY   (1 << 1)
@@ -48,17 +59,61 @@
 #define UART_CTRL_TX_IRQ_EN    (1 << 1)
 #define UART_CTRL_RESET        (1 << 2)
 
+/* host side the uart is attached to, see la64_uart_attach */
+#define LA64_UART_BACKEND_STDIO     0
+#define LA64_UART_BACKEND_PTY       1
+#define LA64_UART_BACKEND_SOCKET    2
+#define LA64_UART_BACKEND_FILE      3
+#define LA64_UART_BACKEND_NULL      4
+
 typedef struct la64_machine la64_machine_t;
 
 typedef struct {
+    /*
+     * receive fifo, the io loop is the only producer
+     * and the core the only consumer, so it needs no lock,
+     * head and tail are free running counters.
+     */
     uint8_t rx_buf[UART_BUF_SIZE];
-    uint32_t rx_head, rx_tail;
-    uint32_t status;
+    atomic_uint_fast32_t rx_head;
+    atomic_uint_fast32_t rx_tail;
+    atomic_uint status;         /* sticky bits only, the rest derives from the fifos */
     uint32_t control;
+
+    /* rx interrupt coalescing, like the trigger levels of a 16550 */
+    uint32_t rx_trigger;
+    uint32_t rx_timeout;
+    atomic_bool rx_irq_sent;
     
-    pthread_t thread;
-    pthread_mutex_t mutex;
+    /* input side runs as callbacks on the machines io loop */
     atomic_bool running;
+    la64_ioloop_source_t *rx_source;
+    la64_ioloop_source_t *listen_source;
+    la64_ioloop_source_t *idle_timer;
+
+    /*
+     * transmit ring, the core only appends and the writer
+     * thread drains whatever piled up with a single writev,
+     * head and tail are free running counters.
+     */
+    uint8_t tx_buf[UART_TX_BUF_SIZE];
+    atomic_uint_fast32_t tx_head;
+    atomic_uint_fast32_t tx_tail;
+    atomic_bool tx_waiting;
+    atomic_bool tx_running;
+    pthread_t tx_thread;
+    pthread_mutex_t tx_mutex;
+    pthread_cond_t tx_cond;
+
+    /* backend, -1 where a direction is not connected */
+    int backend;
+    int listen_fd;
+    atomic_int rx_fd;
+    atomic_int tx_fd;
+
+    /* terminal settings the stdio backend puts back when it lets go */
+    struct termios orig_termios;
+    bool raw_mode;
 
     la64_machine_t *machine;
 } la64_uart_t;
@@ -66,6 +121,8 @@ typedef struct {
 la64_uart_t *la64_uart_alloc(la64_machine_t *machine);
 void la64_uart_dealloc(la64_uart_t *u);
 
+bool la64_uart_attach(la64_uart_t *u, const char *spec);
+
 uint64_t la64_uart_read(la64_core_t *core, void *device, uint64_t offset, int size);
 void la64_uart_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size);
 
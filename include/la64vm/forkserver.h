@@ -0,0 +1,71 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_FORKSERVER_H
+#define LA64VM_FORKSERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <la64vm/core.h>
+#include <la64vm/device/timer.h>
+
+/*
+ * once the guest writes the platform ready register the
+ * machine stops and only its ram (a memfd), core state,
+ * clocks and configuration are kept, the process is single
+ * threaded again after the machine went away. every
+ * connection to the control socket forks a clone that maps
+ * the ram copy on write, brings up fresh devices from the
+ * same configuration and resumes right after the ready
+ * store with the connection as its console.
+ */
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    int ram_fd;
+    uint64_t memory_size;
+    la64_core_t core;
+
+    /* clones keep counting from where the server stopped */
+    uint64_t boot_cycles;
+    la64_timer_channel_t timer_channels[LA64_TIMER_CHANNELS];
+
+    /* replayed on every clone */
+    char *disk_path;
+    uint64_t balloon_ctrl;
+    uint64_t balloon_target;
+
+    char *socket_path;
+    int listen_fd;
+    uint64_t clone_cnt;
+} la64_forkserver_t;
+
+la64_forkserver_t *la64_forkserver_alloc(la64_machine_t *machine, const char *socket_path, const char *disk_path);
+void la64_forkserver_dealloc(la64_forkserver_t *server);
+
+void la64_forkserver_run(la64_forkserver_t *server);
+
+#endif /* LA64VM_FORKSERVER_H */
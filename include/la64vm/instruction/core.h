@@ -29,5 +29,6 @@
 
 void la64_op_hlt(la64_core_t *core);
 void la64_op_nop(la64_core_t *core);
+void la64_op_tlbi(la64_core_t *core);
 
 #endif /* LA64VM_INSTRUCTION_CORE_H */
@@ -40,9 +40,12 @@ void la64_op_bnz(la64_core_t *core);
 
 void la64_push(la64_core_t *core, uint64_t value);
 uint64_t la64_pop(la64_core_t *core);
+void la64_swap_bank(la64_core_t *core);
 
 void la64_op_bl(la64_core_t *core);
 void la64_op_ret(la64_core_t *core);
 void la64_op_iret(la64_core_t *core);
+void la64_op_mfb(la64_core_t *core);
+void la64_op_mtb(la64_core_t *core);
 
 #endif /* LA64VM_INSTRUCTION_CTRL_H */
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef LA64VM_IOLOOP_H
+#define LA64VM_IOLOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * one host i/o thread per process, shared by every machine
+ * in it. devices hand it file descriptors, timers and events
+ * and get called back on that thread, which is where they
+ * feed their queues and raise interrupts from. epoll with
+ * timerfd and eventfd on linux, poll with deadlines and a
+ * pipe everywhere else.
+ */
+
+#define LA64_IOLOOP_SOURCE_FD       0
+#define LA64_IOLOOP_SOURCE_TIMER    1
+#define LA64_IOLOOP_SOURCE_EVENT    2
+
+#define LA64_IOLOOP_MAX_EVENTS      64
+
+typedef void (*la64_ioloop_fn)(void *ctx);
+
+typedef struct la64_ioloop_source {
+    int kind;
+    int fd;
+    la64_ioloop_fn fn;
+    void *ctx;
+    bool dead;
+    bool always_ready;      /* not pollable (regular files), dispatched every round */
+    struct la64_ioloop_source *next;
+#if !defined(__linux__)
+    int wfd;                /* write end of the event pipe */
+    atomic_uint_fast64_t deadline;  /* timers, 0 means disarmed, armed without the loop mutex */
+    atomic_uint_fast64_t interval;
+#endif /* !__linux__ */
+} la64_ioloop_source_t;
+
+typedef struct la64_ioloop {
+    pthread_t thread;
+    pthread_mutex_t mutex;  /* recursive, callbacks run with it held */
+    atomic_bool running;
+    int refcnt;
+
+    la64_ioloop_source_t *sources;
+    la64_ioloop_source_t *graveyard;   /* removed sources, freed by the loop thread */
+
+    /* kicks the loop out of its wait */
+    la64_ioloop_source_t *wakeup;
+#if defined(__linux__)
+    int epfd;
+    atomic_int always_ready_cnt;
+#endif /* __linux__ */
+} la64_ioloop_t;
+
+la64_ioloop_t *la64_ioloop_acquire(void);
+void la64_ioloop_release(la64_ioloop_t *loop);
+
+la64_ioloop_source_t *la64_ioloop_add_fd(la64_ioloop_t *loop, int fd, la64_ioloop_fn fn, void *ctx);
+la64_ioloop_source_t *la64_ioloop_add_timer(la64_ioloop_t *loop, la64_ioloop_fn fn, void *ctx);
+la64_ioloop_source_t *la64_ioloop_add_event(la64_ioloop_t *loop, la64_ioloop_fn fn, void *ctx);
+void la64_ioloop_remove(la64_ioloop_t *loop, la64_ioloop_source_t *source);
+
+/* callbacks run with the loop locked, holding it keeps all of them out, e.g. while several sources go away together */
+void la64_ioloop_lock(la64_ioloop_t *loop);
+void la64_ioloop_unlock(la64_ioloop_t *loop);
+
+void la64_ioloop_arm_timer(la64_ioloop_t *loop, la64_ioloop_source_t *timer, uint64_t first_ns, uint64_t interval_ns);
+void la64_ioloop_signal(la64_ioloop_source_t *event);
+
+#endif /* LA64VM_IOLOOP_H */
@@ -28,10 +28,20 @@
 #include <la64vm/core.h>
 #include <la64vm/memory.h>
 #include <la64vm/mmio.h>
+#include <la64vm/profiler.h>
+#include <la64vm/ioloop.h>
 
 #include <la64vm/device/timer.h>
 #include <la64vm/device/interrupt.h>
 #include <la64vm/device/uart.h>
+#include <la64vm/device/pmu.h>
+#include <la64vm/device/blitter.h>
+#include <la64vm/device/disk.h>
+#include <la64vm/device/net.h>
+#include <la64vm/device/dma.h>
+#include <la64vm/device/timepage.h>
+#include <la64vm/device/shm.h>
+#include <la64vm/device/balloon.h>
 
 #if defined(__linux__)  || defined(__APPLE__)
 #include <la64vm/device/display.h>
@@ -39,19 +49,41 @@
 
 #include <stdint.h>
 
+/* guest ram of a machine started from the command line or a job list */
+#define LA64_MACHINE_DEFAULT_MEMORY 0x20000000
+
 typedef struct la64_machine {
     la64_core_t *core;
     la64_memory_t *memory;
     la64_mmio_bus_t *mmio_bus;
+    la64_ioloop_t *ioloop;
     la64_intc_t *intc;
     la64_timer_t *timer;
     la64_uart_t *uart;
+    la64_pmu_t *pmu;
+    la64_blitter_t *blitter;
+    la64_disk_t *disk;
+    la64_net_t *net;
+    la64_dma_t *dma;
+    la64_timepage_t *timepage;
+    la64_shm_t *shm;
+    la64_balloon_t *balloon;
 #if defined(__linux__)  || defined(__APPLE__)
     la64_display_t *display;
 #endif /* __linux__ */
+    la64_profiler_t *profiler;
+
+    /* what the guest left in the platform exit register */
+    uint64_t exit_code;
+
+    /* fork server, see la64vm/forkserver.h */
+    bool fork_server;
+    bool ready;
+    uint64_t clone_id;
 } la64_machine_t;
 
 la64_machine_t *la64_machine_alloc(uint64_t memory_size);
 void la64_machine_dealloc(la64_machine_t *machine);
+bool la64_machine_boot(la64_machine_t *machine, const char *image_path);
 
 #endif /* LA64VM_MACHINE_H */
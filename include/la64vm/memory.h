@@ -31,17 +31,38 @@
 
 #include <la64vm/core.h>
 
+/* ram beyond the main block, anonymous or shared with a host file */
+#define LA64_MEMORY_MAX_REGIONS 8
+
+typedef struct {
+    uint64_t base;
+    uint64_t size;
+    uint8_t *memory;
+    bool persistent;    /* MAP_SHARED over a host file, survives the vm */
+} la64_memory_region_t;
+
 typedef struct la64_memory {
     uint8_t *memory;
     uint64_t memory_size;
+    int fd;             /* memfd behind the main block once shared, -1 otherwise */
+    bool cloned;        /* main block is a private mapping of a fork servers memfd */
+    la64_memory_region_t region[LA64_MEMORY_MAX_REGIONS];
+    int region_cnt;
 } la64_memory_t;
 
 la64_memory_t *la64_memory_alloc(uint64_t size);
 void la64_memory_dealloc(la64_memory_t *memory);
 
 bool la64_memory_load_image(la64_memory_t *memory, const char *image_path);
+bool la64_memory_add_region(la64_machine_t *machine, uint64_t base, uint64_t size, const char *path);
+bool la64_memory_discard(la64_memory_t *memory, uint64_t addr, uint64_t size, bool lazy);
+bool la64_memory_set_mergeable(la64_memory_t *memory);
+bool la64_memory_share(la64_memory_t *memory);
+bool la64_memory_clone(la64_memory_t *memory, int fd);
 
 void *la64_memory_access(la64_core_t *core, uint64_t addr, size_t size);
+void *la64_memory_map(la64_machine_t *machine, uint64_t addr, size_t size, bool write);
+void la64_memory_mark_dirty(la64_machine_t *machine, uint64_t addr, size_t size);
 bool la64_memory_read(la64_core_t *core, uint64_t addr, size_t size, uint64_t *value);
 bool la64_memory_write(la64_core_t *core, uint64_t addr, uint64_t value, size_t size);
 
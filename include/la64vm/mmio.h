@@ -26,7 +26,9 @@
 #define LA64VM_MMIO_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 typedef struct la64_core la64_core_t;
 
@@ -39,6 +41,10 @@ typedef struct {
     void *device;
     mmio_read_fn read;
     mmio_write_fn write;
+    uint8_t *ram;           /* non-NULL for regions backed by plain host memory */
+    atomic_uchar *dirty;    /* optional, one flag per (1 << dirty_shift) bytes of ram */
+    uint8_t dirty_shift;
+    bool readonly;          /* ram the guest may load from but not store to */
 } la64_mmio_region_t;
 
 #define MAX_MMIO_REGIONS 32
@@ -55,6 +61,21 @@ la64_mmio_bus_t *la64_mmio_alloc(void);
 void la64_mmio_dealloc(la64_mmio_bus_t *bus);
 
 bool la64_mmio_register(la64_mmio_bus_t *bus, uint64_t base, uint64_t size, void *device, mmio_read_fn read, mmio_write_fn write);
+bool la64_mmio_register_ram(la64_mmio_bus_t *bus, uint64_t base, uint64_t size, uint8_t *ram, atomic_uchar *dirty, uint8_t dirty_shift);
+bool la64_mmio_register_rom(la64_mmio_bus_t *bus, uint64_t base, uint64_t size, uint8_t *ram);
 la64_mmio_region_t *la64_mmio_find(la64_mmio_bus_t *bus, uint64_t addr);
 
+static inline void la64_mmio_mark_dirty(la64_mmio_region_t *region,
+                                        uint64_t addr,
+                                        size_t size)
+{
+    uint64_t offset = addr - region->base_addr;
+
+    /* after the data, paired with the acquire of whoever takes the flag */
+    for(uint64_t i = offset >> region->dirty_shift; i <= (offset + size - 1) >> region->dirty_shift; i++)
+    {
+        atomic_store_explicit(&region->dirty[i], 1, memory_order_release);
+    }
+}
+
 #endif /* LA64VM_MMIO_H */
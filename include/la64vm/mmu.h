@@ -34,14 +34,27 @@
 /* page table entry flags */
 #define LA64_MMU_PT_PRESENT         0b00000001
 #define LA64_MMU_PT_USER            0b00000010
-#define LA64_MMU_PT_DIRTY           0b00000100
+#define LA64_MMU_PT_DIRTY           0b00000100  /* set by the mmu on the first write through a leaf */
 #define LA64_MMU_PT_READ            0b00001000
 #define LA64_MMU_PT_WRITE           0b00010000
 #define LA64_MMU_PT_EXEC            0b00100000
+#define LA64_MMU_PT_LARGE           0b01000000  /* l3 or l2 entry is a leaf mapping 8G or 8M */
+#define LA64_MMU_PT_GLOBAL          0b10000000  /* leaf is cached for every asid, meant for kernel mappings */
+#define LA64_MMU_PT_ACCESSED        0x8000000000000000  /* set by the mmu on the first access through a leaf, the flag byte is full */
+
+/* crptb carries the address space identifier in bits 1 to 7 of its flag byte */
+#define LA64_MMU_ASID_SHIFT         1
+#define LA64_MMU_ASID_MASK          0x7F
+
+/* where the index of each level starts in a virtual address, also the size of its pages */
+#define LA64_MMU_L4_SHIFT           43
+#define LA64_MMU_L3_SHIFT           33      /* 8G pages */
+#define LA64_MMU_L2_SHIFT           23      /* 8M pages */
+#define LA64_MMU_L1_SHIFT           13      /* 8K pages */
 
 /* page table enry masks */
 #define LA64_MMU_MASK_FLAGS         0b0000000000000000000000000000000000000000000000000000000011111111
-#define LA64_MMU_MASK_PFN           0b1111111111111111111111111111111111111111111111111111111100000000
+#define LA64_MMU_MASK_PFN           0b0111111111111111111111111111111111111111111111111111111100000000
 
 /* entry helper types */
 typedef uint64_t la64_mmu_entry_t;
@@ -53,6 +66,27 @@ typedef uint64_t la64_mmu_pfn_t;
 #define LA64_MMU_ACC_WRITE          0b01
 #define LA64_MMU_ACC_EXEC           0b10
 
+/*
+ * page fault status, written to CR6 (CRFSR) while CR5 (CRFAR)
+ * gets the faulting virtual address, the low two bits are
+ * the access type of the faulting access.
+ */
+#define LA64_MMU_FAULT_ACC          0b0011
+#define LA64_MMU_FAULT_PRESENT      0b0100  /* page was mapped, permissions refused the access */
+#define LA64_MMU_FAULT_USER         0b1000  /* faulted in user elevation */
+
+/* paging is off until CR4 is present and handlers always run physical */
+static inline bool la64_mmu_enabled(la64_core_t *core)
+{
+    return (core->rl[LA64_REGISTER_CR4] & LA64_MMU_PT_PRESENT) &&
+           !core->in_interrupt;
+}
+
 bool la64_mmu_access(la64_core_t *core, uint64_t vaddr, uint8_t acc, uint64_t *paddr);
+bool la64_mmu_probe(la64_core_t *core, uint64_t vaddr, uint8_t acc, uint64_t *paddr);
+
+void la64_mmu_invalidate_all(la64_core_t *core);
+void la64_mmu_invalidate_asid(la64_core_t *core, uint8_t asid);
+void la64_mmu_invalidate_addr(la64_core_t *core, uint8_t asid, uint64_t vaddr);
 
 #endif /* LA64VM_MMU_H */
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_PROFILER_H
+#define LA64VM_PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <la64vm/core.h>
+
+#define LA64_PROFILER_DEFAULT_HZ        997     /* prime, so we dont sample in lockstep with the guest timer */
+#define LA64_PROFILER_MAX_DEPTH         64
+
+/*
+ * layout of the frames the profiler unwinds, bl pushes 15
+ * registers starting with the return address and leaves FP
+ * at the free slot below them, the interrupt controller
+ * pushes 17 starting with CR0 and PC onto CR1, both frames
+ * store the callers FP at the same offset.
+ */
+#define LA64_PROFILER_FRAME_RA          (15 * 8)
+#define LA64_PROFILER_FRAME_FP          (14 * 8)
+#define LA64_PROFILER_IRQ_FRAME_SIZE    (17 * 8)
+#define LA64_PROFILER_IRQ_FRAME_PC      (16 * 8)
+
+typedef struct {
+    uint64_t addr;
+    char *name;
+} la64_profiler_symbol_t;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t count;
+    uint8_t depth;
+    uint64_t pc[LA64_PROFILER_MAX_DEPTH];   /* innermost frame first */
+} la64_profiler_stack_t;
+
+typedef struct la64_profiler {
+    /* where the folded stacks are written to */
+    char *output_path;
+
+    /* global labels out of the la64asm symbol map, sorted by address */
+    la64_profiler_symbol_t *symbol;
+    uint64_t symbol_cnt;
+
+    /* open addressed table of unique stacks */
+    la64_profiler_stack_t *stack;
+    uint64_t stack_cap;
+    uint64_t stack_cnt;
+
+    /* sampling period in host cycles */
+    uint64_t interval;
+    uint64_t next_sample;
+    uint64_t sample_cnt;
+} la64_profiler_t;
+
+la64_profiler_t *la64_profiler_alloc(la64_machine_t *machine, const char *output_path, uint64_t hz);
+void la64_profiler_dealloc(la64_profiler_t *profiler);
+
+bool la64_profiler_load_symbols(la64_profiler_t *profiler, const char *map_path);
+bool la64_profiler_write(la64_profiler_t *profiler);
+
+void la64_profiler_sample(la64_profiler_t *profiler, la64_core_t *core);
+
+static inline void la64_profiler_tick(la64_profiler_t *profiler,
+                                      la64_core_t *core,
+                                      uint64_t host_cycles)
+{
+    /* checking if the next sample is due */
+    if(host_cycles < profiler->next_sample)
+    {
+        return;
+    }
+
+    profiler->next_sample = host_cycles + profiler->interval;
+    la64_profiler_sample(profiler, core);
+}
+
+#endif /* LA64VM_PROFILER_H */
@@ -0,0 +1,76 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LA64VM_RUNNER_H
+#define LA64VM_RUNNER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * batch mode, runs every job of a list on its own machine
+ * in this process, a fixed number of workers at a time.
+ * machines share nothing but the io loop, each one gets its
+ * own ram and devices and the console goes to a file or
+ * nowhere.
+ */
+
+#define LA64_JOB_PENDING    0
+#define LA64_JOB_DONE       1   /* guest powered off, exit_code is valid */
+#define LA64_JOB_TIMEOUT    2
+#define LA64_JOB_FAILED     3   /* the machine never started */
+
+typedef struct la64_machine la64_machine_t;
+
+typedef struct {
+    char *image_path;
+    char *console_path;     /* NULL drops the console */
+
+    int state;
+    uint64_t exit_code;
+    uint64_t runtime_ns;
+
+    /* only valid while a worker runs the job */
+    la64_machine_t *machine;
+} la64_job_t;
+
+typedef struct {
+    la64_job_t *job;
+    int job_cnt;
+    atomic_int next_job;
+
+    int worker_cnt;
+    uint64_t timeout_ms;    /* 0 lets jobs run forever */
+} la64_runner_t;
+
+la64_runner_t *la64_runner_alloc(const char *job_list_path, int worker_cnt, uint64_t timeout_ms);
+void la64_runner_dealloc(la64_runner_t *runner);
+
+void la64_runner_run(la64_runner_t *runner);
+int la64_runner_report(la64_runner_t *runner, FILE *out);
+
+#endif /* LA64VM_RUNNER_H */
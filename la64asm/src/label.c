@@ -145,3 +145,58 @@ void code_token_label_insert_start(compiler_invocation_t *ci)
     fdwalker_seek(&fw, 0, 0);
     fdwalker_write(&fw, addr, 64);
 }
+
+static int label_map_compare(const void *a,
+                             const void *b)
+{
+    const compiler_label_t *la = *(const compiler_label_t **)a;
+    const compiler_label_t *lb = *(const compiler_label_t **)b;
+
+    if(la->addr != lb->addr)
+    {
+        return (la->addr < lb->addr) ? -1 : 1;
+    }
+
+    return strcmp(la->name, lb->name);
+}
+
+void code_token_label_write_map(compiler_invocation_t *ci)
+{
+    /* opening symbol map */
+    FILE *fp = fopen(ci->symbol_map_path, "w");
+
+    if(fp == NULL)
+    {
+        diag_error(NULL, "couldnt open symbol map at %s\n", ci->symbol_map_path);
+    }
+
+    /* sorting a view of the label table by address */
+    compiler_label_t **view = calloc(ci->label_cnt + 1, sizeof(compiler_label_t *));
+
+    for(uint64_t i = 0; i < ci->label_cnt; i++)
+    {
+        view[i] = &(ci->label[i]);
+    }
+
+    qsort(view, ci->label_cnt, sizeof(compiler_label_t *), label_map_compare);
+
+    /*
+     * writing it in the same layout nm uses, T marks global
+     * labels, t local labels and D entries of .data and .bss
+     * (those got no token link as they dont come from a label line)
+     */
+    for(uint64_t i = 0; i < ci->label_cnt; i++)
+    {
+        char type = 'D';
+
+        if(view[i]->ctlink != NULL)
+        {
+            type = (view[i]->ctlink->cl->type == COMPILER_LINE_TYPE_LOCAL_LABEL) ? 't' : 'T';
+        }
+
+        fprintf(fp, "%016llx %c %s\n", (unsigned long long)view[i]->addr, type, view[i]->name);
+    }
+
+    free(view);
+    fclose(fp);
+}
@@ -23,6 +23,7 @@
  */
 
 #include <la64asm/macro.h>
+#include <la64vm/mmu.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
@@ -32,6 +33,27 @@ typedef struct {
     const char *value;
 } compiler_macro_t;
 
+#define MACRO_STR(x) #x
+#define MACRO_VALUE(x) MACRO_STR(x)
+
+/* macros every source gets, so page tables can be built without magic numbers */
+static const compiler_macro_t builtin_macro[] = {
+    { .name = "%PTE_PRESENT%",   .value = MACRO_VALUE(LA64_MMU_PT_PRESENT) },
+    { .name = "%PTE_USER%",      .value = MACRO_VALUE(LA64_MMU_PT_USER) },
+    { .name = "%PTE_DIRTY%",     .value = MACRO_VALUE(LA64_MMU_PT_DIRTY) },
+    { .name = "%PTE_READ%",      .value = MACRO_VALUE(LA64_MMU_PT_READ) },
+    { .name = "%PTE_WRITE%",     .value = MACRO_VALUE(LA64_MMU_PT_WRITE) },
+    { .name = "%PTE_EXEC%",      .value = MACRO_VALUE(LA64_MMU_PT_EXEC) },
+    { .name = "%PTE_LARGE%",     .value = MACRO_VALUE(LA64_MMU_PT_LARGE) },
+    { .name = "%PTE_GLOBAL%",    .value = MACRO_VALUE(LA64_MMU_PT_GLOBAL) },
+    { .name = "%PTE_ACCESSED%",  .value = MACRO_VALUE(LA64_MMU_PT_ACCESSED) },
+    { .name = "%ASID_SHIFT%",    .value = MACRO_VALUE(LA64_MMU_ASID_SHIFT) },
+    { .name = "%PTE_PFN_SHIFT%", .value = "8" },
+    { .name = "%PAGE_SHIFT%",    .value = MACRO_VALUE(LA64_MMU_L1_SHIFT) },
+    { .name = "%PAGE_SHIFT_8M%", .value = MACRO_VALUE(LA64_MMU_L2_SHIFT) },
+    { .name = "%PAGE_SHIFT_8G%", .value = MACRO_VALUE(LA64_MMU_L3_SHIFT) },
+};
+
 void code_token_macro(compiler_invocation_t *ci)
 {
     /* count the amount of macros */
@@ -74,6 +96,15 @@ void code_token_macro(compiler_invocation_t *ci)
                         ci->line[i].token[a].str = strdup(cm[b].value);
                     }
                 }
+
+                for(uint64_t b = 0; b < sizeof(builtin_macro) / sizeof(builtin_macro[0]); b++)
+                {
+                    if(strcmp(ci->line[i].token[a].str, builtin_macro[b].name) == 0)
+                    {
+                        free(ci->line[i].token[a].str);
+                        ci->line[i].token[a].str = strdup(builtin_macro[b].value);
+                    }
+                }
             }
         }
     }
@@ -41,6 +41,7 @@ int main(int argc, char *argv[])
     int file_count = 0;
     char **files = calloc(argc, sizeof(char *));
     const char *start_entry_name = "_start";
+    const char *symbol_map_path = NULL;
 
     /* invocation settings */
     bool page_align = true;
@@ -99,6 +100,24 @@ int main(int argc, char *argv[])
 
             start_entry_name = flag;
         }
+        else if(strncmp(argv[i], "-m", 2) == 0)
+        {
+            const char *flag;
+            if(argv[i][2] != '\0')
+            {
+                flag = argv[i] + 2;
+            }
+            else if(i + 1 < argc)
+            {
+                flag = argv[++i];
+            }
+            else
+            {
+                diag_error(NULL, "missing argument to '-m'\n");
+            }
+
+            symbol_map_path = flag;
+        }
         else if(argv[i][0] != '-')
         {
             files[file_count++] = strdup(argv[i]);
@@ -126,6 +145,7 @@ int main(int argc, char *argv[])
 
     ci->page_align = page_align;
     ci->start_entry_name = start_entry_name;
+    ci->symbol_map_path = symbol_map_path;
 
     /* remaining arguments are input files */
     if(file_count <= 0)
@@ -147,6 +167,12 @@ int main(int argc, char *argv[])
     /* insert entry */
     code_token_label_insert_start(ci);
 
+    /* symbol map for the profiler of the virtual machine */
+    if(ci->symbol_map_path != NULL)
+    {
+        code_token_label_write_map(ci);
+    }
+
     /* its oneshot */
     /* compiler_invocation_dealloc(ci); */
 
@@ -84,6 +84,11 @@ const opcode_entry_t opcode_table[] = {
     { .name = "bl",     .opcode = LA64_OPCODE_BL,           .minargs = 1, .maxargs = 32, .argmask = 0b00000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
     { .name = "ret",    .opcode = LA64_OPCODE_RET,          .minargs = 0, .maxargs = 0,  .argmask = 0b00000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
     { .name = "iret",    .opcode = LA64_OPCODE_IRET,        .minargs = 0, .maxargs = 0,  .argmask = 0b00000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
+    { .name = "mfb",    .opcode = LA64_OPCODE_MFB,          .minargs = 2, .maxargs = 2,  .argmask = 0b11000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
+    { .name = "mtb",    .opcode = LA64_OPCODE_MTB,          .minargs = 2, .maxargs = 2,  .argmask = 0b11000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
+
+    /* memory management operations */
+    { .name = "tlbi",   .opcode = LA64_OPCODE_TLBI,         .minargs = 0, .maxargs = 2,  .argmask = 0b00000000000000000000000000000000, .dnstr = NULL, .handler = la64_compiler_emit_instr_default },
 
     /* compatibility stubs for older code */
     { .name = "jmp",    .opcode = LA64_OPCODE_B,            .minargs = 1, .maxargs = 1,  .argmask = 0b00000000000000000000000000000000, .dnstr = "use \"b\" instead", .handler = la64_compiler_emit_instr_default },
@@ -70,6 +70,8 @@ register_entry_t register_table[] = {
     { .name = "crexc", .reg = LA64_REGISTER_CR2 },
     { .name = "crvec", .reg = LA64_REGISTER_CR3 },
     { .name = "crptb", .reg = LA64_REGISTER_CR4 },
+    { .name = "crfar", .reg = LA64_REGISTER_CR5 },
+    { .name = "crfsr", .reg = LA64_REGISTER_CR6 },
 };
 
 register_entry_t *register_from_string(const char *name)
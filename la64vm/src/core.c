@@ -31,10 +31,13 @@
 #include <la64vm/core.h>
 #include <la64vm/memory.h>
 #include <la64vm/machine.h>
+#include <la64vm/mmu.h>
 
 #include <la64vm/device/interrupt.h>
 #include <la64vm/device/timer.h>
 
+#include <la64vm/profiler.h>
+
 #include <la64vm/instruction/core.h>
 #include <la64vm/instruction/data.h>
 #include <la64vm/instruction/alu.h>
@@ -102,7 +105,12 @@ la64_opfunc_t opfunc_table[] = {
     [LA64_OPCODE_BNZ] = la64_op_bnz,
     [LA64_OPCODE_BL] = la64_op_bl,
     [LA64_OPCODE_RET] = la64_op_ret,
-    [LA64_OPCODE_IRET] = la64_op_iret
+    [LA64_OPCODE_IRET] = la64_op_iret,
+    [LA64_OPCODE_MFB] = la64_op_mfb,
+    [LA64_OPCODE_MTB] = la64_op_mtb,
+
+    /* memory management operations */
+    [LA64_OPCODE_TLBI] = la64_op_tlbi
 };
 
 static const uint8_t opcode_maxargs[256] = {
@@ -158,6 +166,10 @@ static const uint8_t opcode_maxargs[256] = {
     [LA64_OPCODE_BL] = 32,
     [LA64_OPCODE_RET] = 0,
     [LA64_OPCODE_IRET] = 0,
+    [LA64_OPCODE_MFB] = 2,
+    [LA64_OPCODE_MTB] = 2,
+
+    [LA64_OPCODE_TLBI] = 2,
 };
 
 la64_core_t *la64_core_alloc()
@@ -186,8 +198,59 @@ static void la64_core_decode_instruction_at_pc(la64_core_t *core)
     /* reset operation structure */
     memset(&(core->op), 0, sizeof(la64_operation_t));
 
-    /* accessing memory */
-    void *iptr = la64_memory_access(core, core->rl[LA64_REGISTER_PC], 100);
+    /* instructions are fetched through the mmu like any other access */
+    uint64_t pc = core->rl[LA64_REGISTER_PC];
+    uint64_t paddr = 0;
+
+    if(!la64_mmu_access(core, pc, LA64_MMU_ACC_EXEC, &paddr))
+    {
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_BAD_ACCESS;
+        return;
+    }
+
+    /* bytes left on the page the instruction starts on */
+    uint64_t avail = LA64_MMU_PAGE_SIZE - (pc & (LA64_MMU_PAGE_SIZE - 1));
+    bool tail_fault = false;
+
+    void *iptr = NULL;
+    uint8_t fetch[256];
+
+    if(!la64_mmu_enabled(core) ||
+       avail >= 100)
+    {
+        /* accessing memory */
+        iptr = la64_memory_access(core, paddr, 100);
+    }
+    else
+    {
+        /* straddling a page, the next one need not be mapped or even contiguous */
+        void *head = la64_memory_access(core, paddr, avail);
+
+        if(head != NULL)
+        {
+            memset(fetch, 0, sizeof(fetch));
+            memcpy(fetch, head, avail);
+
+            uint64_t tail_paddr = 0;
+            void *tail = NULL;
+
+            if(la64_mmu_probe(core, pc + avail, LA64_MMU_ACC_EXEC, &tail_paddr))
+            {
+                tail = la64_memory_access(core, tail_paddr, 100 - avail);
+            }
+
+            if(tail != NULL)
+            {
+                memcpy(fetch + avail, tail, 100 - avail);
+            }
+            else
+            {
+                tail_fault = true;
+            }
+
+            iptr = fetch;
+        }
+    }
 
     /* null pointer check */
     if(iptr == NULL)
@@ -264,6 +327,14 @@ static void la64_core_decode_instruction_at_pc(la64_core_t *core)
     /* finding out how many steps the the program counter has to jump */
     core->op.ilen = bitwalker_bytes_used(&bw);
 
+    /* only now we know if the instruction really reaches into the next page */
+    if(tail_fault &&
+       core->op.ilen > avail)
+    {
+        la64_mmu_access(core, pc + avail, LA64_MMU_ACC_EXEC, &paddr);
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_BAD_ACCESS;
+    }
+
     return;
 }
 
@@ -279,7 +350,7 @@ static void *la64_core_execute_thread(void *arg)
     la64_core_t *core = arg;
 
     /* going into da execution loop */
-    while(1)
+    while(!atomic_load_explicit(&core->stop, memory_order_relaxed))
     {
         if(!core->in_interrupt)
         {
@@ -300,8 +371,17 @@ static void *la64_core_execute_thread(void *arg)
         }
 
         /* decoding instruction */
+        core->page_fault = false;
         la64_core_decode_instruction_at_pc(core);
 
+        /* nothing ran yet, pc still points at the instruction to restart */
+        if(core->page_fault &&
+           !core->in_interrupt)
+        {
+            core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_PAGE_FAULT;
+            continue;
+        }
+
         /* sanity check */
         if((core->rl[LA64_REGISTER_CR2] != LA64_EXCEPTION_NONE ||
             core->op.op > LA64_OPCODE_MAX ||
@@ -312,25 +392,41 @@ static void *la64_core_execute_thread(void *arg)
             continue;
         }
 
+        /* all a faulting instruction may have moved before it faulted */
+        uint64_t pc = core->rl[LA64_REGISTER_PC];
+        uint64_t sp = core->rl[LA64_REGISTER_SP];
+        uint64_t fp = core->rl[LA64_REGISTER_FP];
+
         /* executing instruction */
         opfunc_table[core->op.op](core);
 
+        /* rolling back instead of retiring, so iret restarts it */
+        if(core->page_fault)
+        {
+            core->rl[LA64_REGISTER_PC] = pc;
+            core->rl[LA64_REGISTER_SP] = sp;
+            core->rl[LA64_REGISTER_FP] = fp;
+            core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_PAGE_FAULT;
+            continue;
+        }
+
+        la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_INSTRUCTIONS);
+
         /* incrementing program counter by instruction size */
         core->rl[LA64_REGISTER_PC] += core->op.ilen;
 
         /*
-         * if we are in a interrupt then there is no reason
-         * to check if we shall serve another interrupt.
+         * while in a interrupt the controller decides if a
+         * higher priority line may preempt the handler.
          * if we dont check if the instruction executes was
          * the return from interrupt controller then there is
          * a potential for a hardware occuring TOCTOU vulnerability,
          * because we would just immediately interrupt into another
          * interrupt handler in the interrupt vector table.
          */
-        if(core->in_interrupt ||
-           core->op.op == LA64_OPCODE_IRET)
+        if(core->op.op == LA64_OPCODE_IRET)
         {
-            goto tick_timer;
+            goto tick_devices;
         }
 
         /* interrupt controller checking routine starts here */
@@ -339,10 +435,22 @@ skip_execution:
         /* serve interrupt for the interrupt controller */
         la64_serve_interrupt_if_needed(core);
 
-        /* tick the timer always */
-    tick_timer:
+        /* ticking the devices that still run off the core */
+    tick_devices:
         {
-            la64_timer_tick(core->machine->timer, la64_get_host_cycles());
+            uint64_t host_cycles = la64_get_host_cycles();
+
+            la64_timepage_tick(core->machine->timepage, host_cycles);
+
+#if defined(__linux__) || defined(__APPLE__)
+            la64_display_tick(core->machine->display, host_cycles);
+#endif /* __linux__ || __APPLE__ */
+
+            /* sampling profiler rides on the same clock */
+            if(core->machine->profiler != NULL)
+            {
+                la64_profiler_tick(core->machine->profiler, core, host_cycles);
+            }
         }
     }
 
@@ -372,16 +480,11 @@ void la64_core_execute(la64_core_t *core)
 void la64_core_terminate(la64_core_t *core)
 {
     /* sanity check */
-    if(core == NULL ||
-       core->pthread == 0)
+    if(core == NULL)
     {
         return;
     }
-    
-    if(pthread_self() == core->pthread)
-    {
-        pthread_exit(NULL);
-    }
-    
-    pthread_cancel(core->pthread);
+
+    /* the loop checks it between instructions, halted or not */
+    atomic_store(&core->stop, true);
 }
@@ -0,0 +1,144 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <la64vm/machine.h>
+#include <la64vm/mmu.h>
+
+#include <la64vm/device/balloon.h>
+
+static void balloon_report(la64_balloon_t *balloon,
+                           uint64_t count)
+{
+    la64_balloon_range_t *list = NULL;
+    la64_balloon_range_t *range = NULL;
+
+    /* the whole list has to be readable before anything is dropped */
+    if(count == 0 ||
+       count > BALLOON_MAX_RANGES ||
+       (list = la64_memory_map(balloon->machine, balloon->list, count * sizeof(la64_balloon_range_t), false)) == NULL ||
+       (range = malloc(count * sizeof(la64_balloon_range_t))) == NULL)
+    {
+        balloon->rejected += count;
+        return;
+    }
+
+    /* copying it out first, the list may sit inside a range it reports */
+    memcpy(range, list, count * sizeof(la64_balloon_range_t));
+
+    bool lazy = balloon->ctrl & BALLOON_CTRL_LAZY;
+
+    for(uint64_t i = 0; i < count; i++)
+    {
+        la64_balloon_range_t report = range[i];
+
+        if(la64_memory_discard(balloon->machine->memory, report.addr, report.len, lazy))
+        {
+            balloon->returned += report.len / LA64_MMU_PAGE_SIZE;
+        }
+        else
+        {
+            balloon->rejected++;
+        }
+    }
+
+    free(range);
+}
+
+la64_balloon_t *la64_balloon_alloc(la64_machine_t *machine)
+{
+    /* allocate balloon device */
+    la64_balloon_t *balloon = calloc(1, sizeof(la64_balloon_t));
+
+    if(balloon == NULL)
+    {
+        return NULL;
+    }
+
+    /* register balloon MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_BALLOON_BASE, LA64_BALLOON_SIZE, balloon, la64_balloon_read, la64_balloon_write))
+    {
+        free(balloon);
+        return NULL;
+    }
+
+    balloon->machine = machine;
+
+    return balloon;
+}
+
+void la64_balloon_dealloc(la64_balloon_t *balloon)
+{
+    free(balloon);
+}
+
+uint64_t la64_balloon_read(la64_core_t *core,
+                           void *device,
+                           uint64_t offset,
+                           int size)
+{
+    la64_balloon_t *balloon = (la64_balloon_t *)device;
+
+    switch(offset)
+    {
+        case BALLOON_REG_LIST:
+            return balloon->list;
+        case BALLOON_REG_RETURNED:
+            return balloon->returned;
+        case BALLOON_REG_REJECTED:
+            return balloon->rejected;
+        case BALLOON_REG_TARGET:
+            return balloon->target;
+        case BALLOON_REG_CTRL:
+            return balloon->ctrl;
+        default:
+            return 0;
+    }
+}
+
+void la64_balloon_write(la64_core_t *core,
+                        void *device,
+                        uint64_t offset,
+                        uint64_t value,
+                        int size)
+{
+    la64_balloon_t *balloon = (la64_balloon_t *)device;
+
+    switch(offset)
+    {
+        case BALLOON_REG_LIST:
+            balloon->list = value;
+            return;
+        case BALLOON_REG_COUNT:
+            balloon_report(balloon, value);
+            return;
+        case BALLOON_REG_CTRL:
+            balloon->ctrl = value;
+            return;
+        default:
+            return;
+    }
+}
@@ -0,0 +1,428 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <la64vm/machine.h>
+#include <la64vm/memory.h>
+
+#include <la64vm/device/blitter.h>
+#include <la64vm/device/interrupt.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif /* __x86_64__ */
+
+static void blit_keyed_row_scalar(uint8_t *dst,
+                                  const uint8_t *src,
+                                  size_t n,
+                                  uint8_t key)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        if(src[i] != key)
+        {
+            dst[i] = src[i];
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static void blit_keyed_row_avx2(uint8_t *dst,
+                                const uint8_t *src,
+                                size_t n,
+                                uint8_t key)
+{
+    const __m256i k = _mm256_set1_epi8((char)key);
+
+    size_t i = 0;
+
+    /* keyed pixels keep the destination, the rest takes the source */
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[i]);
+        __m256i d = _mm256_loadu_si256((const __m256i *)&dst[i]);
+        _mm256_storeu_si256((__m256i *)&dst[i], _mm256_blendv_epi8(s, d, _mm256_cmpeq_epi8(s, k)));
+    }
+
+    blit_keyed_row_scalar(&dst[i], &src[i], n - i, key);
+}
+#endif /* __x86_64__ */
+
+static void blit_remap_row(uint8_t *dst,
+                           const uint8_t *src,
+                           size_t n,
+                           const uint8_t *table)
+{
+    /* a 256 entry byte lookup has no cheap vector form below avx512 vbmi */
+    for(size_t i = 0; i < n; i++)
+    {
+        dst[i] = table[src[i]];
+    }
+}
+
+static bool blit_extent(uint64_t pitch,
+                        uint64_t w,
+                        uint64_t h,
+                        uint64_t *extent)
+{
+    /* pitch * (h - 1) + w, failing instead of wrapping */
+    return !__builtin_mul_overflow(pitch, h - 1, extent) &&
+           !__builtin_add_overflow(*extent, w, extent);
+}
+
+static bool blit_execute(la64_blitter_t *blitter,
+                         const la64_blit_desc_t *desc)
+{
+    uint64_t w = desc->width;
+    uint64_t h = desc->height;
+
+    /* empty rects are trivially done */
+    if(w == 0 || h == 0)
+    {
+        return true;
+    }
+
+    /* rows of one surface may not overlap each other */
+    if(h > 1 &&
+       (desc->dst_pitch < w ||
+        (desc->op != BLIT_OP_FILL && desc->src_pitch < w)))
+    {
+        return false;
+    }
+
+    uint64_t dst_extent = 0;
+    uint64_t src_extent = 0;
+
+    if(!blit_extent(desc->dst_pitch, w, h, &dst_extent) ||
+       (desc->op != BLIT_OP_FILL && !blit_extent(desc->src_pitch, w, h, &src_extent)))
+    {
+        return false;
+    }
+
+    uint8_t *dst = la64_memory_map(blitter->machine, desc->dst, dst_extent, true);
+
+    if(dst == NULL)
+    {
+        return false;
+    }
+
+    if(desc->op == BLIT_OP_FILL)
+    {
+        for(uint64_t y = 0; y < h; y++)
+        {
+            memset(&dst[y * desc->dst_pitch], (uint8_t)desc->src, w);
+        }
+
+        la64_memory_mark_dirty(blitter->machine, desc->dst, dst_extent);
+        return true;
+    }
+
+    const uint8_t *src = la64_memory_map(blitter->machine, desc->src, src_extent, false);
+
+    if(src == NULL)
+    {
+        return false;
+    }
+
+    const uint8_t *table = NULL;
+
+    if(desc->op == BLIT_OP_REMAP)
+    {
+        table = la64_memory_map(blitter->machine, desc->table, 256, false);
+
+        if(table == NULL)
+        {
+            return false;
+        }
+    }
+
+    /* walking bottom up when the destination trails the source, like memmove */
+    bool backwards = (dst > src);
+
+    /* rows that overlap within themselves go through a scratch row first */
+    uint8_t *scratch = NULL;
+
+    if(desc->op != BLIT_OP_COPY &&
+       dst != src &&
+       (size_t)(dst > src ? dst - src : src - dst) < w)
+    {
+        scratch = malloc(w);
+
+        if(scratch == NULL)
+        {
+            return false;
+        }
+    }
+
+    for(uint64_t i = 0; i < h; i++)
+    {
+        uint64_t y = backwards ? h - 1 - i : i;
+
+        uint8_t *d = &dst[y * desc->dst_pitch];
+        const uint8_t *s = &src[y * desc->src_pitch];
+
+        if(scratch != NULL)
+        {
+            memcpy(scratch, s, w);
+            s = scratch;
+        }
+
+        switch(desc->op)
+        {
+            case BLIT_OP_COPY:
+                memmove(d, s, w);
+                break;
+            case BLIT_OP_KEYED:
+#if defined(__x86_64__)
+                if(__builtin_cpu_supports("avx2"))
+                {
+                    blit_keyed_row_avx2(d, s, w, (uint8_t)desc->key);
+                    break;
+                }
+#endif /* __x86_64__ */
+                blit_keyed_row_scalar(d, s, w, (uint8_t)desc->key);
+                break;
+            case BLIT_OP_REMAP:
+                blit_remap_row(d, s, w, table);
+                break;
+            default:
+                free(scratch);
+                return false;
+        }
+    }
+
+    free(scratch);
+
+    /* the display may pick the rows up only once they hold the result */
+    la64_memory_mark_dirty(blitter->machine, desc->dst, dst_extent);
+
+    return true;
+}
+
+static void blit_drain(la64_blitter_t *blitter)
+{
+    uint64_t mask = blitter->ring_size - 1;
+
+    atomic_fetch_or(&blitter->status, BLIT_STATUS_BUSY);
+
+    while(atomic_load(&blitter->head) != atomic_load(&blitter->tail))
+    {
+        uint64_t head = atomic_load(&blitter->head);
+
+        la64_blit_desc_t *desc = la64_memory_map(blitter->machine, blitter->ring_base + (head & mask) * sizeof(la64_blit_desc_t), sizeof(la64_blit_desc_t), true);
+
+        /* working off a copy, the guest may rewrite the ring while we run */
+        la64_blit_desc_t copy;
+
+        if(desc != NULL)
+        {
+            memcpy(&copy, desc, sizeof(copy));
+        }
+
+        bool ok = (desc != NULL && blit_execute(blitter, &copy));
+
+        if(!ok)
+        {
+            atomic_fetch_or(&blitter->status, BLIT_STATUS_ERROR);
+        }
+
+        if(desc != NULL)
+        {
+            desc->status = ok ? BLIT_DESC_DONE : BLIT_DESC_ERROR;
+        }
+
+        atomic_store(&blitter->head, head + 1);
+    }
+
+    atomic_fetch_and(&blitter->status, ~(uint64_t)BLIT_STATUS_BUSY);
+    atomic_fetch_or(&blitter->status, BLIT_STATUS_DONE);
+
+    if(blitter->ctrl & BLIT_CTRL_IRQ_EN)
+    {
+        la64_raise_interrupt(blitter->machine, LA64_IRQ_BLITTER);
+    }
+}
+
+static void *blitter_thread(void *arg)
+{
+    la64_blitter_t *blitter = (la64_blitter_t *)arg;
+
+    while(atomic_load(&blitter->running))
+    {
+        /* sleeping until the guest rings the doorbell */
+        pthread_mutex_lock(&blitter->mutex);
+
+        while(atomic_load(&blitter->running) &&
+              atomic_load(&blitter->head) == atomic_load(&blitter->tail))
+        {
+            pthread_cond_wait(&blitter->cond, &blitter->mutex);
+        }
+
+        pthread_mutex_unlock(&blitter->mutex);
+
+        if(!atomic_load(&blitter->running))
+        {
+            break;
+        }
+
+        blit_drain(blitter);
+    }
+
+    return NULL;
+}
+
+la64_blitter_t *la64_blitter_alloc(la64_machine_t *machine)
+{
+    /* allocate blitter */
+    la64_blitter_t *blitter = calloc(1, sizeof(la64_blitter_t));
+
+    if(blitter == NULL)
+    {
+        return NULL;
+    }
+
+    /* register blitter MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_BLIT_BASE, LA64_BLIT_SIZE, blitter, la64_blitter_read, la64_blitter_write))
+    {
+        free(blitter);
+        return NULL;
+    }
+
+    blitter->machine = machine;
+
+    pthread_mutex_init(&blitter->mutex, NULL);
+    pthread_cond_init(&blitter->cond, NULL);
+    atomic_store(&blitter->running, true);
+
+    if(pthread_create(&blitter->thread, NULL, blitter_thread, blitter) != 0)
+    {
+        pthread_cond_destroy(&blitter->cond);
+        pthread_mutex_destroy(&blitter->mutex);
+        free(blitter);
+        return NULL;
+    }
+
+    return blitter;
+}
+
+void la64_blitter_dealloc(la64_blitter_t *blitter)
+{
+    /* waking the worker so it notices */
+    pthread_mutex_lock(&blitter->mutex);
+    atomic_store(&blitter->running, false);
+    pthread_cond_broadcast(&blitter->cond);
+    pthread_mutex_unlock(&blitter->mutex);
+
+    pthread_join(blitter->thread, NULL);
+
+    pthread_cond_destroy(&blitter->cond);
+    pthread_mutex_destroy(&blitter->mutex);
+    free(blitter);
+}
+
+uint64_t la64_blitter_read(la64_core_t *core,
+                           void *device,
+                           uint64_t offset,
+                           int size)
+{
+    /* getting blitter */
+    la64_blitter_t *blitter = (la64_blitter_t *)device;
+
+    /* perform read */
+    switch(offset)
+    {
+        case BLIT_REG_CTRL:
+            return blitter->ctrl;
+        case BLIT_REG_RING_BASE:
+            return blitter->ring_base;
+        case BLIT_REG_RING_SIZE:
+            return blitter->ring_size;
+        case BLIT_REG_HEAD:
+            return atomic_load(&blitter->head);
+        case BLIT_REG_TAIL:
+            return atomic_load(&blitter->tail);
+        case BLIT_REG_STATUS:
+            return atomic_load(&blitter->status);
+        default:
+            return 0;
+    }
+}
+
+void la64_blitter_write(la64_core_t *core,
+                        void *device,
+                        uint64_t offset,
+                        uint64_t value,
+                        int size)
+{
+    /* getting blitter */
+    la64_blitter_t *blitter = (la64_blitter_t *)device;
+
+    /* the ring can only be reconfigured while the blitter is idle */
+    bool idle = atomic_load(&blitter->head) == atomic_load(&blitter->tail);
+
+    /* perform write */
+    switch(offset)
+    {
+        case BLIT_REG_CTRL:
+            blitter->ctrl = value;
+            return;
+        case BLIT_REG_RING_BASE:
+            if(idle)
+            {
+                blitter->ring_base = value;
+            }
+            return;
+        case BLIT_REG_RING_SIZE:
+            if(idle)
+            {
+                blitter->ring_size = value;
+            }
+            return;
+        case BLIT_REG_TAIL:
+            /* a broken ring never reaches the worker */
+            if(!(blitter->ctrl & BLIT_CTRL_ENABLE) ||
+               blitter->ring_size == 0 ||
+               (blitter->ring_size & (blitter->ring_size - 1)) != 0 ||
+               value - atomic_load(&blitter->head) > blitter->ring_size)
+            {
+                atomic_fetch_or(&blitter->status, BLIT_STATUS_ERROR);
+                return;
+            }
+
+            pthread_mutex_lock(&blitter->mutex);
+            atomic_store(&blitter->tail, value);
+            pthread_cond_signal(&blitter->cond);
+            pthread_mutex_unlock(&blitter->mutex);
+            return;
+        case BLIT_REG_STATUS:
+            atomic_fetch_and(&blitter->status, ~(value & (BLIT_STATUS_DONE | BLIT_STATUS_ERROR)));
+            return;
+        default:
+            return;
+    }
+}
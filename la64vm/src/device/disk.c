@@ -0,0 +1,760 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif /* __linux__ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+#endif /* __linux__ */
+
+#include <la64vm/machine.h>
+#include <la64vm/memory.h>
+
+#include <la64vm/device/disk.h>
+#include <la64vm/device/interrupt.h>
+
+static bool disk_prepare(la64_disk_t *disk,
+                         const la64_disk_desc_t *desc,
+                         la64_disk_req_t *req)
+{
+    /* read once, the guest may rewrite the descriptor while we check it */
+    uint32_t op = desc->op;
+    uint32_t count = desc->count;
+    uint64_t sector = desc->sector;
+    uint64_t addr = desc->addr;
+
+    req->op = op;
+
+    if(disk->fd < 0)
+    {
+        return false;
+    }
+
+    if(op == DISK_OP_FLUSH)
+    {
+        req->iov.iov_base = NULL;
+        req->iov.iov_len = 0;
+        return true;
+    }
+
+    if((op != DISK_OP_READ && op != DISK_OP_WRITE) ||
+       count == 0 ||
+       sector > disk->capacity ||
+       count > disk->capacity - sector)
+    {
+        return false;
+    }
+
+    size_t len = (size_t)count * DISK_SECTOR_SIZE;
+
+    /* the host reads straight into guest ram, no bounce buffer */
+    void *buf = la64_memory_map(disk->machine, addr, len, op == DISK_OP_READ);
+
+    if(buf == NULL)
+    {
+        return false;
+    }
+
+    req->addr = addr;
+    req->offset = sector * DISK_SECTOR_SIZE;
+    req->iov.iov_base = buf;
+    req->iov.iov_len = len;
+    return true;
+}
+
+static void disk_complete(la64_disk_t *disk,
+                          la64_disk_req_t *req,
+                          bool ok)
+{
+    la64_disk_desc_t *desc = la64_memory_map(disk->machine, req->desc, sizeof(la64_disk_desc_t), true);
+
+    if(!ok)
+    {
+        atomic_fetch_or(&disk->status, DISK_STATUS_ERROR);
+    }
+    else if(req->op == DISK_OP_READ)
+    {
+        la64_memory_mark_dirty(disk->machine, req->addr, req->iov.iov_len);
+    }
+
+    if(desc != NULL)
+    {
+        /* the data has to be there before the guest sees the status */
+        atomic_thread_fence(memory_order_release);
+        desc->status = ok ? DISK_DESC_DONE : DISK_DESC_ERROR;
+    }
+
+    req->next = disk->free;
+    disk->free = req;
+    atomic_fetch_sub(&disk->inflight, 1);
+}
+
+static void disk_notify(la64_disk_t *disk)
+{
+    /* one interrupt per batch of completions */
+    atomic_fetch_or(&disk->status, DISK_STATUS_DONE);
+
+    if(disk->ctrl & DISK_CTRL_IRQ_EN)
+    {
+        la64_raise_interrupt(disk->machine, LA64_IRQ_DISK);
+    }
+}
+
+#if defined(__linux__)
+static bool disk_uring_setup(la64_disk_uring_t *ring)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, DISK_MAX_INFLIGHT, &p);
+
+    if(ring->fd < 0)
+    {
+        return false;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    /* newer kernels share one mapping between both rings */
+    if(p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(ring->cq_len > ring->sq_len)
+        {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = 0;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+    if(ring->sq_ptr == MAP_FAILED)
+    {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->cq_ptr = ring->sq_ptr;
+
+    if(ring->cq_len != 0)
+    {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+        if(ring->cq_ptr == MAP_FAILED)
+        {
+            goto out_unmap_sq;
+        }
+    }
+
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if(ring->sqes == MAP_FAILED)
+    {
+        goto out_unmap_cq;
+    }
+
+    ring->sq_head = (unsigned *)((uint8_t *)ring->sq_ptr + p.sq_off.head);
+    ring->sq_tail = (unsigned *)((uint8_t *)ring->sq_ptr + p.sq_off.tail);
+    ring->sq_mask = (unsigned *)((uint8_t *)ring->sq_ptr + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((uint8_t *)ring->sq_ptr + p.sq_off.array);
+    ring->cq_head = (unsigned *)((uint8_t *)ring->cq_ptr + p.cq_off.head);
+    ring->cq_tail = (unsigned *)((uint8_t *)ring->cq_ptr + p.cq_off.tail);
+    ring->cq_mask = (unsigned *)((uint8_t *)ring->cq_ptr + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cq_ptr + p.cq_off.cqes);
+
+    /* completions wake the io loop through an eventfd */
+    ring->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(ring->efd < 0)
+    {
+        goto out_unmap_sqes;
+    }
+
+    if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD, &ring->efd, 1) < 0)
+    {
+        close(ring->efd);
+        goto out_unmap_sqes;
+    }
+
+    return true;
+
+out_unmap_sqes:
+    munmap(ring->sqes, ring->sqes_len);
+out_unmap_cq:
+    if(ring->cq_len != 0)
+    {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+out_unmap_sq:
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+    return false;
+}
+
+static void disk_uring_teardown(la64_disk_uring_t *ring)
+{
+    munmap(ring->sqes, ring->sqes_len);
+
+    if(ring->cq_len != 0)
+    {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->efd);
+    close(ring->fd);
+}
+
+static void disk_uring_queue(la64_disk_t *disk,
+                             la64_disk_req_t *req)
+{
+    la64_disk_uring_t *ring = &disk->ring;
+
+    /* never more requests than sq entries, so there always is room */
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+
+    sqe->fd = disk->fd;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+
+    switch(req->op)
+    {
+        case DISK_OP_READ:
+            sqe->opcode = IORING_OP_READV;
+            break;
+        case DISK_OP_WRITE:
+            sqe->opcode = IORING_OP_WRITEV;
+            break;
+        default:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+    }
+
+    if(req->op != DISK_OP_FLUSH)
+    {
+        sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+        sqe->len = 1;
+        sqe->off = req->offset;
+    }
+
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static int disk_uring_reap(la64_disk_t *disk)
+{
+    la64_disk_uring_t *ring = &disk->ring;
+
+    unsigned head = *ring->cq_head;
+    int n = 0;
+
+    while(head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        la64_disk_req_t *req = (la64_disk_req_t *)(uintptr_t)cqe->user_data;
+
+        /* short transfers only happen on host errors, the range was checked */
+        disk_complete(disk, req, cqe->res >= 0 && (size_t)cqe->res == req->iov.iov_len);
+
+        head++;
+        n++;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+static bool disk_uring_enter(la64_disk_t *disk,
+                             unsigned min_complete)
+{
+    la64_disk_uring_t *ring = &disk->ring;
+    unsigned flags = (min_complete != 0) ? IORING_ENTER_GETEVENTS : 0;
+
+    for(;;)
+    {
+        /* whatever an earlier enter left in the sq ring goes down too */
+        unsigned pending = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+        if(pending == 0 &&
+           min_complete == 0)
+        {
+            return true;
+        }
+
+        long n = syscall(__NR_io_uring_enter, ring->fd, pending, min_complete, flags, NULL, 0);
+
+        if(n >= 0 &&
+           (unsigned)n == pending)
+        {
+            return true;
+        }
+
+        if(n < 0 &&
+           errno != EINTR &&
+           errno != EAGAIN &&
+           errno != EBUSY)
+        {
+            return false;
+        }
+
+        /* the kernel is short on memory or completion slots, making room before retrying */
+        if(n < 0 &&
+           errno != EINTR)
+        {
+            if(disk_uring_reap(disk) != 0)
+            {
+                disk_notify(disk);
+            }
+
+            sched_yield();
+        }
+    }
+}
+#endif /* __linux__ */
+
+static void disk_submit(la64_disk_t *disk)
+{
+    /* called with disk->mutex held */
+    uint64_t mask = disk->ring_size - 1;
+    bool failed = false;
+
+    while(disk->free != NULL &&
+          atomic_load(&disk->head) != atomic_load(&disk->tail))
+    {
+        uint64_t head = atomic_load(&disk->head);
+        uint64_t addr = disk->ring_base + (head & mask) * sizeof(la64_disk_desc_t);
+
+        atomic_store(&disk->head, head + 1);
+
+        la64_disk_desc_t *desc = la64_memory_map(disk->machine, addr, sizeof(la64_disk_desc_t), true);
+
+        if(desc == NULL)
+        {
+            atomic_fetch_or(&disk->status, DISK_STATUS_ERROR);
+            failed = true;
+            continue;
+        }
+
+        la64_disk_req_t *req = disk->free;
+        disk->free = req->next;
+        req->desc = addr;
+        atomic_fetch_add(&disk->inflight, 1);
+
+        /* bad requests complete right away */
+        if(!disk_prepare(disk, desc, req))
+        {
+            disk_complete(disk, req, false);
+            failed = true;
+            continue;
+        }
+
+#if defined(__linux__)
+        if(disk->uring)
+        {
+            disk_uring_queue(disk, req);
+            continue;
+        }
+#endif /* __linux__ */
+
+        req->next = NULL;
+
+        if(disk->queue_tail != NULL)
+        {
+            disk->queue_tail->next = req;
+        }
+        else
+        {
+            disk->queue = req;
+        }
+
+        disk->queue_tail = req;
+        pthread_cond_signal(&disk->cond);
+    }
+
+#if defined(__linux__)
+    /* the whole batch goes down in one syscall */
+    if(disk->uring &&
+       !disk_uring_enter(disk, 0))
+    {
+        atomic_fetch_or(&disk->status, DISK_STATUS_ERROR);
+        failed = true;
+    }
+#endif /* __linux__ */
+
+    if(failed)
+    {
+        disk_notify(disk);
+    }
+}
+
+#if defined(__linux__)
+static void disk_uring_ready(void *ctx)
+{
+    la64_disk_t *disk = (la64_disk_t *)ctx;
+
+    uint64_t cnt;
+    ssize_t n = read(disk->ring.efd, &cnt, sizeof(cnt));
+    (void)n;
+
+    pthread_mutex_lock(&disk->mutex);
+
+    if(disk_uring_reap(disk) != 0)
+    {
+        disk_notify(disk);
+
+        /* freed slots let waiting descriptors in */
+        disk_submit(disk);
+    }
+
+    pthread_mutex_unlock(&disk->mutex);
+}
+#endif /* __linux__ */
+
+static bool disk_execute(la64_disk_t *disk,
+                         la64_disk_req_t *req)
+{
+    if(req->op == DISK_OP_FLUSH)
+    {
+        return fsync(disk->fd) == 0;
+    }
+
+    uint8_t *buf = req->iov.iov_base;
+    size_t left = req->iov.iov_len;
+    off_t off = (off_t)req->offset;
+
+    while(left > 0)
+    {
+        ssize_t n = (req->op == DISK_OP_READ) ? pread(disk->fd, buf, left, off) : pwrite(disk->fd, buf, left, off);
+
+        if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(n <= 0)
+        {
+            return false;
+        }
+
+        buf += n;
+        left -= n;
+        off += n;
+    }
+
+    return true;
+}
+
+static void *disk_worker(void *arg)
+{
+    la64_disk_t *disk = (la64_disk_t *)arg;
+
+    pthread_mutex_lock(&disk->mutex);
+
+    /* the queue is drained before the workers leave */
+    while(disk->running || disk->queue != NULL)
+    {
+        if(disk->queue == NULL)
+        {
+            pthread_cond_wait(&disk->cond, &disk->mutex);
+            continue;
+        }
+
+        la64_disk_req_t *req = disk->queue;
+        disk->queue = req->next;
+
+        if(disk->queue == NULL)
+        {
+            disk->queue_tail = NULL;
+        }
+
+        pthread_mutex_unlock(&disk->mutex);
+        bool ok = disk_execute(disk, req);
+        pthread_mutex_lock(&disk->mutex);
+
+        disk_complete(disk, req, ok);
+        disk_notify(disk);
+        disk_submit(disk);
+    }
+
+    pthread_mutex_unlock(&disk->mutex);
+
+    return NULL;
+}
+
+bool la64_disk_attach(la64_disk_t *disk,
+                      const char *path)
+{
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+
+    /* read only images still boot, writes fail per request */
+    if(fd < 0)
+    {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+    }
+
+    if(fd < 0)
+    {
+        fprintf(stderr, "[!] failed to open disk image %s\n", path);
+        return false;
+    }
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    disk->fd = fd;
+    disk->capacity = (uint64_t)st.st_size / DISK_SECTOR_SIZE;
+
+#if defined(__linux__)
+    /* io_uring when the kernel lets us, worker threads otherwise */
+    if(disk_uring_setup(&disk->ring))
+    {
+        disk->uring_source = la64_ioloop_add_fd(disk->machine->ioloop, disk->ring.efd, disk_uring_ready, disk);
+
+        if(disk->uring_source != NULL)
+        {
+            disk->uring = true;
+            return true;
+        }
+
+        disk_uring_teardown(&disk->ring);
+    }
+#endif /* __linux__ */
+
+    disk->running = true;
+
+    for(int i = 0; i < DISK_WORKERS; i++)
+    {
+        if(pthread_create(&disk->workers[i], NULL, disk_worker, disk) != 0)
+        {
+            break;
+        }
+
+        disk->nworkers++;
+    }
+
+    return disk->nworkers != 0;
+}
+
+la64_disk_t *la64_disk_alloc(la64_machine_t *machine)
+{
+    /* allocate disk */
+    la64_disk_t *disk = calloc(1, sizeof(la64_disk_t));
+
+    if(disk == NULL)
+    {
+        return NULL;
+    }
+
+    /* register disk MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_DISK_BASE, LA64_DISK_SIZE, disk, la64_disk_read, la64_disk_write))
+    {
+        free(disk);
+        return NULL;
+    }
+
+    disk->machine = machine;
+    disk->fd = -1;
+
+    pthread_mutex_init(&disk->mutex, NULL);
+    pthread_cond_init(&disk->cond, NULL);
+
+    for(int i = 0; i < DISK_MAX_INFLIGHT; i++)
+    {
+        disk->reqs[i].next = disk->free;
+        disk->free = &disk->reqs[i];
+    }
+
+    return disk;
+}
+
+void la64_disk_dealloc(la64_disk_t *disk)
+{
+#if defined(__linux__)
+    if(disk->uring)
+    {
+        la64_ioloop_remove(disk->machine->ioloop, disk->uring_source);
+        disk->uring_source = NULL;
+
+        /* the kernel may still be writing into guest ram */
+        pthread_mutex_lock(&disk->mutex);
+
+        while(atomic_load(&disk->inflight) != 0)
+        {
+            /* entries a failed submit left behind go down first, or they never complete */
+            if(!disk_uring_enter(disk, 1))
+            {
+                break;
+            }
+
+            disk_uring_reap(disk);
+        }
+
+        pthread_mutex_unlock(&disk->mutex);
+
+        disk_uring_teardown(&disk->ring);
+    }
+#endif /* __linux__ */
+
+    /* waking the workers so they finish the queue and leave */
+    pthread_mutex_lock(&disk->mutex);
+    disk->running = false;
+    pthread_cond_broadcast(&disk->cond);
+    pthread_mutex_unlock(&disk->mutex);
+
+    for(int i = 0; i < disk->nworkers; i++)
+    {
+        pthread_join(disk->workers[i], NULL);
+    }
+
+    if(disk->fd >= 0)
+    {
+        close(disk->fd);
+    }
+
+    pthread_cond_destroy(&disk->cond);
+    pthread_mutex_destroy(&disk->mutex);
+    free(disk);
+}
+
+uint64_t la64_disk_read(la64_core_t *core,
+                        void *device,
+                        uint64_t offset,
+                        int size)
+{
+    /* getting disk */
+    la64_disk_t *disk = (la64_disk_t *)device;
+
+    /* perform read */
+    switch(offset)
+    {
+        case DISK_REG_CTRL:
+            return disk->ctrl;
+        case DISK_REG_RING_BASE:
+            return disk->ring_base;
+        case DISK_REG_RING_SIZE:
+            return disk->ring_size;
+        case DISK_REG_HEAD:
+            return atomic_load(&disk->head);
+        case DISK_REG_TAIL:
+            return atomic_load(&disk->tail);
+        case DISK_REG_STATUS:
+        {
+            uint64_t status = atomic_load(&disk->status);
+
+            if(atomic_load(&disk->inflight) != 0 ||
+               atomic_load(&disk->head) != atomic_load(&disk->tail))
+            {
+                status |= DISK_STATUS_BUSY;
+            }
+
+            return status;
+        }
+        case DISK_REG_CAPACITY:
+            return disk->capacity;
+        case DISK_REG_INFLIGHT:
+            return atomic_load(&disk->inflight);
+        default:
+            return 0;
+    }
+}
+
+void la64_disk_write(la64_core_t *core,
+                     void *device,
+                     uint64_t offset,
+                     uint64_t value,
+                     int size)
+{
+    /* getting disk */
+    la64_disk_t *disk = (la64_disk_t *)device;
+
+    /* the ring can only be reconfigured while the disk is idle */
+    bool idle = atomic_load(&disk->head) == atomic_load(&disk->tail) &&
+                atomic_load(&disk->inflight) == 0;
+
+    /* perform write */
+    switch(offset)
+    {
+        case DISK_REG_CTRL:
+            disk->ctrl = value;
+            return;
+        case DISK_REG_RING_BASE:
+            if(idle)
+            {
+                disk->ring_base = value;
+            }
+            return;
+        case DISK_REG_RING_SIZE:
+            if(idle)
+            {
+                disk->ring_size = value;
+            }
+            return;
+        case DISK_REG_TAIL:
+            /* a broken ring never reaches the host */
+            if(!(disk->ctrl & DISK_CTRL_ENABLE) ||
+               disk->ring_size == 0 ||
+               (disk->ring_size & (disk->ring_size - 1)) != 0 ||
+               value - atomic_load(&disk->head) > disk->ring_size)
+            {
+                atomic_fetch_or(&disk->status, DISK_STATUS_ERROR);
+                return;
+            }
+
+            pthread_mutex_lock(&disk->mutex);
+            atomic_store(&disk->tail, value);
+            disk_submit(disk);
+            pthread_mutex_unlock(&disk->mutex);
+            return;
+        case DISK_REG_STATUS:
+            atomic_fetch_and(&disk->status, ~(value & (DISK_STATUS_DONE | DISK_STATUS_ERROR)));
+            return;
+        default:
+            return;
+    }
+}
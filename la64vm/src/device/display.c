@@ -30,12 +30,14 @@
 #include <pthread.h>
 #include <stdatomic.h>
 
-#include <lautils/bitwalker.h>
-
 #include <la64vm/machine.h>
 #include <la64vm/device/display.h>
 
-#if defined(__linux__)
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif /* __x86_64__ */
+
+#if defined(__linux__) && !defined(LA64_HEADLESS)
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -192,24 +194,13 @@ void *display_start(void *arg)
     glTexParameteri(GL_TEXTURE_1D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
     glTexParameteri(GL_TEXTURE_1D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
 
-    GLuint pbo[2];
-    glGenBuffers(2,pbo);
-
-    for(int i=0;i<2;i++)
-    {
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER,pbo[i]);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER,LA64_FB_SIZE,NULL,GL_STREAM_DRAW);
-    }
-
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
-
     glUseProgram(prog);
     glUniform1i(glGetUniformLocation(prog,"uIndexTex"),0);
     glUniform1i(glGetUniformLocation(prog,"uPalette"),1);
 
     double prev = now_sec();
     double acc  = 0.0;
-    int pboIdx = 0;
+    unsigned shown = UINT32_MAX;
 
     while(!glfwWindowShouldClose(win))
     {
@@ -219,16 +210,29 @@ void *display_start(void *arg)
         acc += now - prev;
         prev = now;
 
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER,pbo[pboIdx]);
-        uint8_t* ptr = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,0,LA64_FB_SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-        memcpy(ptr, display->fb, LA64_FB_SIZE);
-        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        /* after a flip the whole buffer is new, otherwise only rows the guest touched get uploaded */
+        unsigned front = atomic_load(&display->front);
+        uint8_t *fb = la64_display_buffer(display, front);
+        bool all = (front != shown);
+        shown = front;
 
         glBindTexture(GL_TEXTURE_2D,texIndex);
         glPixelStorei(GL_UNPACK_ALIGNMENT,1);
-        glTexSubImage2D(GL_TEXTURE_2D,0,0,0,LA64_FB_WIDTH,LA64_FB_HEIGHT,GL_RED,GL_UNSIGNED_BYTE,NULL);
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
-        pboIdx ^= 1;
+
+        int y = 0;
+        int rows;
+
+        while((rows = la64_display_take_dirty_rows(display, front, all, &y)) > 0)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D,0,0,y,LA64_FB_WIDTH,rows,GL_RED,GL_UNSIGNED_BYTE,&fb[y * LA64_FB_WIDTH]);
+            y += rows;
+        }
+
+        if(la64_display_take_dirty_palette(display))
+        {
+            glBindTexture(GL_TEXTURE_1D,texPal);
+            glTexSubImage1D(GL_TEXTURE_1D,0,0,256,GL_RGB,GL_UNSIGNED_BYTE,display->palette);
+        }
 
         int ww,wh;
         glfwGetFramebufferSize(win,&ww,&wh);
@@ -250,13 +254,270 @@ void *display_start(void *arg)
     return 0;
 }
 
-#endif /* __linux__ */
+#endif /* __linux__ && !LA64_HEADLESS */
 
+#if !defined(LA64_HEADLESS)
 extern void *display_start(void *arg);
+#endif /* !LA64_HEADLESS */
+
+static void la64_display_expand_scalar(const uint32_t *lut,
+                                       const uint8_t *fb,
+                                       uint8_t *rgb,
+                                       size_t n)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        uint32_t px = lut[fb[i]];
+        rgb[i * 3 + 0] = (uint8_t)px;
+        rgb[i * 3 + 1] = (uint8_t)(px >> 8);
+        rgb[i * 3 + 2] = (uint8_t)(px >> 16);
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static void la64_display_expand_avx2(const uint32_t *lut,
+                                     const uint8_t *fb,
+                                     uint8_t *rgb,
+                                     size_t n)
+{
+    /* squeezes the four 0x00BBGGRR pixels of each lane into 12 packed bytes */
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    size_t i = 0;
+
+    /* the 16 byte stores spill 4 bytes, so the last block always goes the scalar way */
+    for(; i + 16 <= n; i += 8)
+    {
+        __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&fb[i]));
+        __m256i px = _mm256_shuffle_epi8(_mm256_i32gather_epi32((const int *)lut, idx, 4), pack);
+
+        _mm_storeu_si128((__m128i *)&rgb[i * 3], _mm256_castsi256_si128(px));
+        _mm_storeu_si128((__m128i *)&rgb[i * 3 + 12], _mm256_extracti128_si256(px, 1));
+    }
+
+    la64_display_expand_scalar(lut, &fb[i], &rgb[i * 3], n - i);
+}
+#endif /* __x86_64__ */
+
+static void la64_display_expand(const uint8_t *palette,
+                                const uint8_t *fb,
+                                uint8_t *rgb)
+{
+    /* widening the palette once so each pixel is a single lookup */
+    uint32_t lut[256];
+
+    for(int i = 0; i < 256; i++)
+    {
+        lut[i] = palette[i * 3] | (palette[i * 3 + 1] << 8) | (palette[i * 3 + 2] << 16);
+    }
+
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        la64_display_expand_avx2(lut, fb, rgb, LA64_FB_WIDTH * LA64_FB_HEIGHT);
+        return;
+    }
+#endif /* __x86_64__ */
+
+    la64_display_expand_scalar(lut, fb, rgb, LA64_FB_WIDTH * LA64_FB_HEIGHT);
+}
+
+static bool la64_display_dump_frame(la64_display_t *display,
+                                    uint8_t *rgb)
+{
+    la64_display_expand(display->palette, la64_display_buffer(display, atomic_load(&display->front)), rgb);
+
+    /* binary ppm, readable by about everything */
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%06llu.ppm", display->dump_prefix, (unsigned long long)display->dump_cnt++);
+
+    FILE *fp = fopen(path, "wb");
+
+    if(fp == NULL)
+    {
+        fprintf(stderr, "[display] failed to open frame dump at path %s\n", path);
+        return false;
+    }
+
+    fprintf(fp, "P6\n%d %d\n255\n", LA64_FB_WIDTH, LA64_FB_HEIGHT);
+    fwrite(rgb, 3, LA64_FB_WIDTH * LA64_FB_HEIGHT, fp);
+    fclose(fp);
+
+    return true;
+}
+
+static void display_dump_tick(void *ctx)
+{
+    la64_display_t *display = (la64_display_t*)ctx;
+    la64_display_dump_frame(display, display->dump_rgb);
+}
+
+static void display_dump_requested(void *ctx)
+{
+    la64_display_t *display = (la64_display_t*)ctx;
+
+    if(atomic_exchange(&display->dump_request, false))
+    {
+        la64_display_dump_frame(display, display->dump_rgb);
+    }
+}
+
+void la64_display_request_dump(la64_display_t *display)
+{
+    atomic_store(&display->dump_request, true);
+
+    /* only an eventfd write, so signal handlers can request dumps too */
+    if(display->dump_event != NULL)
+    {
+        la64_ioloop_signal(display->dump_event);
+    }
+}
+
+void la64_display_vblank(la64_display_t *display,
+                         uint64_t host_cycles)
+{
+    display->next_vblank = host_cycles + display->vblank_interval;
+    display->vblank_cnt++;
+
+    /* flips only ever take effect here, so the guest never sees a torn frame */
+    atomic_store(&display->front, display->flip);
+
+    if(display->irq)
+    {
+        la64_raise_interrupt(display->machine, LA64_IRQ_DISPLAY);
+    }
+}
+
+int la64_display_take_dirty_rows(la64_display_t *display,
+                                 unsigned buffer,
+                                 bool all,
+                                 int *y)
+{
+    atomic_uchar *dirty = &(display->dirty[LA64_FB_DIRTY_ROW(buffer, 0)]);
+
+    /* skipping clean rows */
+    while(*y < LA64_FB_HEIGHT &&
+          !atomic_exchange_explicit(&dirty[*y], 0, memory_order_acquire) &&
+          !all)
+    {
+        (*y)++;
+    }
+
+    if(*y >= LA64_FB_HEIGHT)
+    {
+        return 0;
+    }
+
+    /* extending the span over the following dirty rows */
+    int end = *y + 1;
+
+    while(end < LA64_FB_HEIGHT &&
+          (atomic_exchange_explicit(&dirty[end], 0, memory_order_acquire) || all))
+    {
+        end++;
+    }
+
+    return end - *y;
+}
+
+bool la64_display_take_dirty_palette(la64_display_t *display)
+{
+    bool dirty = false;
+
+    /* the palette covers three chunks, all of them have to be consumed */
+    for(int i = 0; i < (LA64_FB_FRAMEBUFFER - LA64_FB_PALLETE) >> LA64_FB_DIRTY_SHIFT; i++)
+    {
+        dirty |= atomic_exchange_explicit(&(display->dirty[LA64_FB_DIRTY_PALETTE + i]), 0, memory_order_acquire);
+    }
+
+    return dirty;
+}
+
+static void la64_display_start(la64_display_t *display)
+{
+    if(display->headless)
+    {
+        /* without a dump prefix there is nothing to do with the frames */
+        if(display->dump_prefix == NULL)
+        {
+            return;
+        }
+
+        la64_ioloop_t *loop = display->machine->ioloop;
+
+        display->dump_rgb = malloc(LA64_FB_WIDTH * LA64_FB_HEIGHT * 3);
+
+        if(display->dump_rgb == NULL)
+        {
+            return;
+        }
+
+        display->dump_event = la64_ioloop_add_event(loop, display_dump_requested, display);
+
+        if(display->dump_interval_ms != 0)
+        {
+            uint64_t interval = display->dump_interval_ms * 1000000ULL;
+
+            display->dump_timer = la64_ioloop_add_timer(loop, display_dump_tick, display);
+
+            if(display->dump_timer != NULL)
+            {
+                la64_ioloop_arm_timer(loop, display->dump_timer, interval, interval);
+            }
+        }
+
+        /* requests from before the display came up */
+        if(atomic_load(&display->dump_request) &&
+           display->dump_event != NULL)
+        {
+            la64_ioloop_signal(display->dump_event);
+        }
+        return;
+    }
+
+#if !defined(LA64_HEADLESS)
+    pthread_create(&(display->pthread), NULL, display_start, display);
+#endif /* !LA64_HEADLESS */
+}
+
+static void la64_display_stop(la64_display_t *display)
+{
+    if(display->headless)
+    {
+        if(display->dump_rgb == NULL)
+        {
+            return;
+        }
+
+        la64_ioloop_t *loop = display->machine->ioloop;
+
+        /* holding the loop so no dump is halfway through */
+        la64_ioloop_lock(loop);
+        la64_ioloop_remove(loop, display->dump_timer);
+        la64_ioloop_remove(loop, display->dump_event);
+        display->dump_timer = NULL;
+        display->dump_event = NULL;
+        la64_ioloop_unlock(loop);
+
+        /* a request racing with shutdown still gets its frame */
+        if(atomic_exchange(&display->dump_request, false))
+        {
+            la64_display_dump_frame(display, display->dump_rgb);
+        }
+
+        free(display->dump_rgb);
+        display->dump_rgb = NULL;
+        return;
+    }
+
+    pthread_cancel(display->pthread);
+}
 
 la64_display_t *la64_display_alloc(la64_machine_t *machine)
 {
-    la64_display_t *display = malloc(sizeof(la64_display_t));
+    la64_display_t *display = calloc(1, sizeof(la64_display_t));
 
     /* null pointer check */
     if(display == NULL)
@@ -264,18 +525,25 @@ la64_display_t *la64_display_alloc(la64_machine_t *machine)
         return NULL;
     }
 
-    if(!la64_mmio_register(machine->mmio_bus, LA64_FB_BASE, LA64_FB_SIZE, display, la64_fb_read, la64_fb_write))
+    /* palette and framebuffer share one allocation, laid out like the guest sees them */
+    display->ram = calloc(1, LA64_FB_RAM_SIZE);
+
+    /* null pointer check */
+    if(display->ram == NULL)
     {
         free(display);
         return NULL;
     }
 
-    /* allocate palette */
-    display->palette = calloc(3, 256);
+    display->palette = display->ram;
+    display->fb = &(display->ram[LA64_FB_FRAMEBUFFER - LA64_FB_PALLETE]);
+    display->back = &(display->ram[LA64_FB_BACKBUFFER - LA64_FB_PALLETE]);
 
-    /* null pointer check */
-    if(display->palette == NULL)
+    if(!la64_mmio_register(machine->mmio_bus, LA64_FB_BASE, LA64_FB_REG_SIZE, display, la64_fb_read, la64_fb_write) ||
+       !la64_mmio_register_ram(machine->mmio_bus, LA64_FB_RAM_BASE, LA64_FB_RAM_SIZE, display->ram, display->dirty, LA64_FB_DIRTY_SHIFT) ||
+       !la64_mmio_register(machine->mmio_bus, LA64_FB_SCAN_BASE, LA64_FB_SCAN_SIZE, display, la64_fb_scan_read, la64_fb_scan_write))
     {
+        free(display->ram);
         free(display);
         return NULL;
     }
@@ -290,15 +558,17 @@ la64_display_t *la64_display_alloc(la64_machine_t *machine)
         display->palette[i*3 + 2] = gray;
     }
 
-    display->fb = calloc(1, LA64_FB_SIZE);
+#if defined(LA64_HEADLESS)
+    /* nothing to draw onto */
+    display->headless = true;
+#endif /* LA64_HEADLESS */
 
-    /* null pointer check */
-    if(display->fb == NULL)
-    {
-        free(display->palette);
-        free(display);
-        return NULL;
-    }
+    atomic_store(&display->dump_request, false);
+
+    /* vblank runs off the same host clock as the timer */
+    display->machine = machine;
+    display->vblank_interval = (uint64_t)(machine->timer->host_freq * LA64_FB_TICK_DT);
+    display->next_vblank = la64_get_host_cycles() + display->vblank_interval;
 
     return display;
 }
@@ -313,18 +583,15 @@ void la64_display_dealloc(la64_display_t *display)
 
     if(display->enabled)
     {
-        pthread_cancel(display->pthread);
+        la64_display_stop(display);
     }
 
-    if(display->palette != NULL)
+    if(display->ram != NULL)
     {
-        free(display->palette);
+        free(display->ram);
     }
 
-    if(display->fb != NULL)
-    {
-        free(display->fb);
-    }
+    free(display);
 }
 
 uint64_t la64_fb_read(la64_core_t *core,
@@ -333,27 +600,7 @@ uint64_t la64_fb_read(la64_core_t *core,
                       int size)
 {
     la64_display_t *display = (la64_display_t*)device;
-
-    if(offset >= LA64_FB_FRAMEBUFFER)
-    {
-        offset -= LA64_FB_FRAMEBUFFER;
-
-        bitwalker_t bw;
-        bitwalker_init_read(&bw, &(display->palette[offset]), size, BW_LITTLE_ENDIAN);
-        return bitwalker_read(&bw, size * 8);
-    }
-    else if(offset >= LA64_FB_PALLETE)
-    {
-        offset -= LA64_FB_PALLETE;
-
-        bitwalker_t bw;
-        bitwalker_init_read(&bw, &(display->palette[offset]), size, BW_LITTLE_ENDIAN);
-        return bitwalker_read(&bw, size * 8);
-    }
-    else
-    {
-        return display->enabled;
-    }
+    return display->enabled;
 }
 
 void la64_fb_write(la64_core_t *core,
@@ -364,35 +611,66 @@ void la64_fb_write(la64_core_t *core,
 {
     la64_display_t *display = (la64_display_t*)device;
 
-    if(offset >= LA64_FB_FRAMEBUFFER)
+    /* dump requests leave the display as it is */
+    if(display->headless &&
+       (value & LA64_FB_CTRL_DUMP))
     {
-        offset -= LA64_FB_FRAMEBUFFER;
-
-        bitwalker_t bw;
-        bitwalker_init(&bw, &(display->fb[offset]), size, BW_LITTLE_ENDIAN);
-        bitwalker_write(&bw, value, size * 8);
+        la64_display_request_dump(display);
         return;
     }
-    else if(offset >= LA64_FB_PALLETE)
-    {
-        offset -= LA64_FB_PALLETE;
 
-        bitwalker_t bw;
-        bitwalker_init(&bw, &(display->palette[offset]), size, BW_LITTLE_ENDIAN);
-        bitwalker_write(&bw, value, size * 8);
-        return;
+    uint8_t enabled = (uint8_t)value;
+
+    if(enabled && !display->enabled)
+    {
+        display->enabled = enabled;
+        la64_display_start(display);
     }
-    else
+    else if(!enabled && display->enabled)
     {
-        if((uint8_t)value)
-        {
-            pthread_create(&(display->pthread), NULL, display_start, device);
-        }
-        else
-        {
-            pthread_cancel(display->pthread);
-        }
+        la64_display_stop(display);
+    }
 
-        display->enabled = (uint8_t)value;
+    display->enabled = enabled;
+}
+
+uint64_t la64_fb_scan_read(la64_core_t *core,
+                           void *device,
+                           uint64_t offset,
+                           int size)
+{
+    la64_display_t *display = (la64_display_t*)device;
+
+    switch(offset + LA64_FB_REG_FLIP)
+    {
+        case LA64_FB_REG_FLIP:
+            return atomic_load(&display->front);
+        case LA64_FB_REG_VBLANK:
+            return display->vblank_cnt;
+        case LA64_FB_REG_IRQ:
+            return display->irq;
+        default:
+            return 0;
+    }
+}
+
+void la64_fb_scan_write(la64_core_t *core,
+                        void *device,
+                        uint64_t offset,
+                        uint64_t value,
+                        int size)
+{
+    la64_display_t *display = (la64_display_t*)device;
+
+    switch(offset + LA64_FB_REG_FLIP)
+    {
+        case LA64_FB_REG_FLIP:
+            display->flip = value & 1;
+            break;
+        case LA64_FB_REG_IRQ:
+            display->irq = value & 1;
+            break;
+        default:
+            break;
     }
 }
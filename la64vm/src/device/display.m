@@ -131,6 +131,7 @@ static GLuint linkProgram(GLuint vs, GLuint fs)
     if (!self) die("NSOpenGLView init failed");
 
     _display = display;
+    _shown = UINT32_MAX;
     [self setWantsBestResolutionOpenGLSurface:YES];
     __weak typeof(self) weakSelf = self;
     _timer = [NSTimer scheduledTimerWithTimeInterval:LA64_FB_TICK_DT repeats:YES block:^(NSTimer *timer){
@@ -229,12 +230,30 @@ static GLuint linkProgram(GLuint vs, GLuint fs)
     NSOpenGLContext *ctx = [self openGLContext];
     [ctx makeCurrentContext];
 
+    /* after a flip the whole buffer is new, otherwise only rows the guest touched get uploaded */
+    unsigned front = atomic_load(&_display->front);
+    uint8_t *fb = la64_display_buffer(_display, front);
+    bool all = (front != _shown);
+    _shown = front;
+
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, _texIndex);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LA64_FB_WIDTH, LA64_FB_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, _display->fb);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, _texPal);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGB, GL_UNSIGNED_BYTE, _display->palette);
+
+    int y = 0;
+    int rows;
+
+    while((rows = la64_display_take_dirty_rows(_display, front, all, &y)) > 0)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, LA64_FB_WIDTH, rows, GL_RED, GL_UNSIGNED_BYTE, &fb[y * LA64_FB_WIDTH]);
+        y += rows;
+    }
+
+    if(la64_display_take_dirty_palette(_display))
+    {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, _texPal);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGB, GL_UNSIGNED_BYTE, _display->palette);
+    }
 
     NSRect px = [self convertRectToBacking:[self bounds]];
     GLint winW = (GLint)px.size.width;
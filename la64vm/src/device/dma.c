@@ -0,0 +1,324 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <la64vm/machine.h>
+#include <la64vm/memory.h>
+
+#include <la64vm/device/dma.h>
+#include <la64vm/device/interrupt.h>
+
+static bool dma_execute(la64_dma_t *dma,
+                        const la64_dma_desc_t *desc)
+{
+    /* empty transfers are trivially done */
+    if(desc->len == 0)
+    {
+        return true;
+    }
+
+    uint8_t *dst = la64_memory_map(dma->machine, desc->dst, desc->len, true);
+
+    if(dst == NULL)
+    {
+        return false;
+    }
+
+    if(desc->flags & DMA_DESC_FILL)
+    {
+        memset(dst, (uint8_t)desc->src, desc->len);
+        la64_memory_mark_dirty(dma->machine, desc->dst, desc->len);
+        return true;
+    }
+
+    const uint8_t *src = la64_memory_map(dma->machine, desc->src, desc->len, false);
+
+    if(src == NULL)
+    {
+        return false;
+    }
+
+    memmove(dst, src, desc->len);
+    la64_memory_mark_dirty(dma->machine, desc->dst, desc->len);
+    return true;
+}
+
+static void dma_run_chain(la64_dma_channel_t *ch)
+{
+    la64_dma_t *dma = ch->dma;
+    uint64_t addr = ch->chain;
+    bool ok = true;
+
+    while(addr != 0 &&
+          !atomic_load(&ch->abort))
+    {
+        la64_dma_desc_t *desc = la64_memory_map(dma->machine, addr, sizeof(la64_dma_desc_t), true);
+
+        if(desc == NULL)
+        {
+            ok = false;
+            break;
+        }
+
+        /* working off a copy, the guest may rewrite the descriptor while we run */
+        la64_dma_desc_t copy;
+        memcpy(&copy, desc, sizeof(copy));
+
+        bool done = dma_execute(dma, &copy);
+
+        /* the data has to be there before the guest sees the status */
+        atomic_thread_fence(memory_order_release);
+        desc->status = done ? DMA_DESC_DONE : DMA_DESC_ERROR;
+        atomic_fetch_add(&ch->completed, 1);
+
+        if(!done)
+        {
+            ok = false;
+            break;
+        }
+
+        if(copy.flags & DMA_DESC_IRQ)
+        {
+            la64_raise_interrupt(dma->machine, LA64_IRQ_DMA);
+        }
+
+        addr = copy.next;
+    }
+
+    if(!ok)
+    {
+        atomic_fetch_or(&ch->status, DMA_STATUS_ERROR);
+    }
+
+    atomic_fetch_and(&ch->status, ~(uint64_t)DMA_STATUS_BUSY);
+    atomic_fetch_or(&ch->status, DMA_STATUS_DONE);
+
+    if(ch->ctrl & DMA_CTRL_IRQ_EN)
+    {
+        la64_raise_interrupt(dma->machine, LA64_IRQ_DMA);
+    }
+}
+
+static void *dma_thread(void *arg)
+{
+    la64_dma_channel_t *ch = (la64_dma_channel_t *)arg;
+    la64_dma_t *dma = ch->dma;
+
+    while(atomic_load(&dma->running))
+    {
+        /* sleeping until the guest starts a chain */
+        pthread_mutex_lock(&ch->mutex);
+
+        while(atomic_load(&dma->running) &&
+              !ch->pending)
+        {
+            pthread_cond_wait(&ch->cond, &ch->mutex);
+        }
+
+        ch->pending = false;
+        pthread_mutex_unlock(&ch->mutex);
+
+        if(!atomic_load(&dma->running))
+        {
+            break;
+        }
+
+        dma_run_chain(ch);
+    }
+
+    return NULL;
+}
+
+la64_dma_t *la64_dma_alloc(la64_machine_t *machine)
+{
+    /* allocate dma controller */
+    la64_dma_t *dma = calloc(1, sizeof(la64_dma_t));
+
+    if(dma == NULL)
+    {
+        return NULL;
+    }
+
+    /* register dma MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_DMA_BASE, LA64_DMA_SIZE, dma, la64_dma_read, la64_dma_write))
+    {
+        free(dma);
+        return NULL;
+    }
+
+    dma->machine = machine;
+    atomic_store(&dma->running, true);
+
+    int i = 0;
+
+    for(; i < LA64_DMA_CHANNELS; i++)
+    {
+        la64_dma_channel_t *ch = &dma->channels[i];
+
+        ch->dma = dma;
+        pthread_mutex_init(&ch->mutex, NULL);
+        pthread_cond_init(&ch->cond, NULL);
+
+        if(pthread_create(&ch->thread, NULL, dma_thread, ch) != 0)
+        {
+            pthread_cond_destroy(&ch->cond);
+            pthread_mutex_destroy(&ch->mutex);
+            break;
+        }
+    }
+
+    /* tearing down the channels that made it */
+    if(i != LA64_DMA_CHANNELS)
+    {
+        atomic_store(&dma->running, false);
+
+        while(i-- > 0)
+        {
+            la64_dma_channel_t *ch = &dma->channels[i];
+
+            pthread_mutex_lock(&ch->mutex);
+            pthread_cond_signal(&ch->cond);
+            pthread_mutex_unlock(&ch->mutex);
+
+            pthread_join(ch->thread, NULL);
+            pthread_cond_destroy(&ch->cond);
+            pthread_mutex_destroy(&ch->mutex);
+        }
+
+        free(dma);
+        return NULL;
+    }
+
+    return dma;
+}
+
+void la64_dma_dealloc(la64_dma_t *dma)
+{
+    atomic_store(&dma->running, false);
+
+    for(int i = 0; i < LA64_DMA_CHANNELS; i++)
+    {
+        la64_dma_channel_t *ch = &dma->channels[i];
+
+        /* a chain in flight stops after its current descriptor */
+        atomic_store(&ch->abort, true);
+
+        /* waking the worker so it notices */
+        pthread_mutex_lock(&ch->mutex);
+        pthread_cond_signal(&ch->cond);
+        pthread_mutex_unlock(&ch->mutex);
+
+        pthread_join(ch->thread, NULL);
+        pthread_cond_destroy(&ch->cond);
+        pthread_mutex_destroy(&ch->mutex);
+    }
+
+    free(dma);
+}
+
+uint64_t la64_dma_read(la64_core_t *core,
+                       void *device,
+                       uint64_t offset,
+                       int size)
+{
+    /* getting dma controller and channel */
+    la64_dma_t *dma = (la64_dma_t *)device;
+    la64_dma_channel_t *ch = &dma->channels[offset / LA64_DMA_CHANNEL_SIZE];
+
+    /* perform read */
+    switch(offset % LA64_DMA_CHANNEL_SIZE)
+    {
+        case DMA_REG_CTRL:
+            return ch->ctrl;
+        case DMA_REG_CHAIN:
+            return ch->chain;
+        case DMA_REG_STATUS:
+            return atomic_load(&ch->status);
+        case DMA_REG_COMPLETED:
+            return atomic_load(&ch->completed);
+        default:
+            return 0;
+    }
+}
+
+void la64_dma_write(la64_core_t *core,
+                    void *device,
+                    uint64_t offset,
+                    uint64_t value,
+                    int size)
+{
+    /* getting dma controller and channel */
+    la64_dma_t *dma = (la64_dma_t *)device;
+    la64_dma_channel_t *ch = &dma->channels[offset / LA64_DMA_CHANNEL_SIZE];
+
+    bool busy = atomic_load(&ch->status) & DMA_STATUS_BUSY;
+
+    /* perform write */
+    switch(offset % LA64_DMA_CHANNEL_SIZE)
+    {
+        case DMA_REG_CTRL:
+            ch->ctrl = value & DMA_CTRL_IRQ_EN;
+
+            if(value & DMA_CTRL_ABORT)
+            {
+                atomic_store(&ch->abort, true);
+            }
+
+            if(!(value & DMA_CTRL_START))
+            {
+                return;
+            }
+
+            /* one chain per channel at a time */
+            if(busy)
+            {
+                atomic_fetch_or(&ch->status, DMA_STATUS_ERROR);
+                return;
+            }
+
+            atomic_store(&ch->abort, false);
+            atomic_store(&ch->completed, 0);
+            atomic_fetch_or(&ch->status, DMA_STATUS_BUSY);
+
+            pthread_mutex_lock(&ch->mutex);
+            ch->pending = true;
+            pthread_cond_signal(&ch->cond);
+            pthread_mutex_unlock(&ch->mutex);
+            return;
+        case DMA_REG_CHAIN:
+            if(!busy)
+            {
+                ch->chain = value;
+            }
+            return;
+        case DMA_REG_STATUS:
+            atomic_fetch_and(&ch->status, ~(value & (DMA_STATUS_DONE | DMA_STATUS_ERROR)));
+            return;
+        default:
+            return;
+    }
+}
@@ -35,7 +35,7 @@
 la64_intc_t *la64_intc_alloc(la64_machine_t *machine)
 {
     /* allocate interrupt controller */
-    la64_intc_t *intc = malloc(sizeof(la64_intc_t));
+    la64_intc_t *intc = calloc(1, sizeof(la64_intc_t));
 
     /* null pointer check */
     if(intc == NULL)
@@ -56,6 +56,14 @@ la64_intc_t *la64_intc_alloc(la64_machine_t *machine)
     intc->ctrl = 0;
     intc->vector_base = 0;
 
+    /* equal priorities and everything routed behave like the old lowest line first */
+    memset(intc->priority, LA64_INTC_PRIO_DEFAULT, sizeof(intc->priority));
+
+    for(int i = 0; i < LA64_INTC_CORES; i++)
+    {
+        intc->route[i] = UINT64_MAX;
+    }
+
     return intc;
 }
 
@@ -74,8 +82,8 @@ void la64_raise_interrupt(la64_machine_t *machine,
         return;
     }
     
-    /* setting pending bit for intc */
-    machine->intc->pending |= (1ULL << irq_line);
+    /* setting pending bit for intc, devices raise from their own threads */
+    __atomic_fetch_or(&machine->intc->pending, (1ULL << irq_line), __ATOMIC_RELEASE);
 }
 
 void la64_clear_interrupt(la64_machine_t *machine,
@@ -89,97 +97,174 @@ void la64_clear_interrupt(la64_machine_t *machine,
     }
     
     /* clear pending bit */
-    machine->intc->pending &= ~(1ULL << irq_line);
+    __atomic_fetch_and(&machine->intc->pending, ~(1ULL << irq_line), __ATOMIC_RELEASE);
+}
+
+static uint8_t intc_running_priority(la64_intc_t *intc)
+{
+    uint8_t running = 0;
+
+    for(int i = 0; i < intc->depth; i++)
+    {
+        if(intc->active[i].priority > running)
+        {
+            running = intc->active[i].priority;
+        }
+    }
+
+    return running;
 }
 
-static int find_pending_irq(la64_intc_t *intc)
+static int find_pending_irq(la64_intc_t *intc,
+                            int core_id)
 {
-    /* get pending and enabled interrupts */
-    uint64_t active = intc->pending & intc->enabled;
+    /* get pending, enabled and routed interrupts */
+    uint64_t active = __atomic_load_n(&intc->pending, __ATOMIC_ACQUIRE) & intc->enabled & intc->route[core_id];
 
     /* checking if interrupts are enabled */
     if(active == 0)
     {
         return -1;
     }
-    
-    /* iterating for lowest set bit */
-    for(int i = 0; i <= LA64_IRQ_MAX; i++)
+
+    /* a line has to beat both the threshold and whatever runs right now */
+    uint8_t floor = intc_running_priority(intc);
+
+    if(intc->threshold > floor)
     {
-        if(active & (1ULL << i))
+        floor = (uint8_t)intc->threshold;
+    }
+
+    int best = -1;
+    uint8_t best_prio = floor;
+
+    /* highest priority wins, the lowest line breaks ties */
+    while(active != 0)
+    {
+        int i = __builtin_ctzll(active);
+        active &= active - 1;
+
+        if(intc->priority[i] > best_prio)
         {
-            return i;
+            best = i;
+            best_prio = intc->priority[i];
         }
     }
     
-    return -1;
+    return best;
+}
+
+bool la64_intc_complete(la64_intc_t *intc)
+{
+    /* leaving the innermost handler, true while outer ones are still running */
+    if(intc->depth > 0)
+    {
+        intc->depth--;
+    }
+
+    intc->current_irq = (intc->depth > 0) ? intc->active[intc->depth - 1].irq : -1;
+
+    return intc->depth > 0;
 }
 
 bool la64_serve_interrupt_if_needed(la64_core_t *core)
 {    
+    la64_intc_t *intc = core->machine->intc;
+
     /* check if interrupts are globally enabled */
-    if(!(core->machine->intc->ctrl & LA64_INTC_CTRL_ENABLE))
+    if(!(intc->ctrl & LA64_INTC_CTRL_ENABLE))
     {
         return false;
     }
     
     /* check if were already servicing an interrupt (unless nesting allowed) */
-    if(core->machine->intc->current_irq >= 0 &&
-       !(core->machine->intc->ctrl & LA64_INTC_CTRL_NESTING))
+    if(intc->depth > 0 &&
+       !(intc->ctrl & LA64_INTC_CTRL_NESTING))
+    {
+        return false;
+    }
+
+    /* every level preempts the one below it, so the stack can not overflow */
+    if(intc->depth > LA64_INTC_PRIO_MAX)
     {
         return false;
     }
     
     /* find highest priority pending interrupt */
-    int irq = find_pending_irq(core->machine->intc);
+    int irq = find_pending_irq(intc, 0);
     if(irq < 0)
     {
         return false;
     }
     
-    /* mark which IRQ were servicing */
-    core->machine->intc->current_irq = irq;
-    
     /* clear pending bit (edge-triggered style) */
-    core->machine->intc->pending &= ~(1ULL << irq);
+    __atomic_fetch_and(&intc->pending, ~(1ULL << irq), __ATOMIC_RELAXED);
 
-    uint64_t vector_addr = core->machine->intc->vector_base + (irq * 8);
+    uint64_t vector_addr = intc->vector_base + (irq * 8);
     
     /* read handler address from vector table */
     void *vector_ptr = la64_memory_access(core, vector_addr, 8);
     if(vector_ptr == NULL)
     {
-        core->machine->intc->current_irq = -1;
         return false;
     }
 
+    /* only the outermost entry can own the single shadow bank */
+    bool banked = (intc->ctrl & LA64_INTC_CTRL_BANKED) && !core->in_interrupt;
+
+    /* mark which IRQ were servicing */
+    intc->active[intc->depth].irq = irq;
+    intc->active[intc->depth].priority = intc->priority[irq];
+    intc->active[intc->depth].banked = banked;
+    intc->depth++;
+    intc->current_irq = irq;
+
     uint64_t handler_addr = *(uint64_t *)vector_ptr;
 
-    /* jump to handler */
-    uint64_t oldsp = core->rl[LA64_REGISTER_SP];
-    uint64_t oldel = core->rl[LA64_REGISTER_CR0];
-
-    core->rl[LA64_REGISTER_CR0] = LA64_ELEVATION_KERNEL;
-    core->rl[LA64_REGISTER_SP] = core->rl[LA64_REGISTER_CR1];
-
-    /* creating interrupt stack frame */
-    la64_push(core, oldel);
-    la64_push(core, core->rl[LA64_REGISTER_PC]);
-    la64_push(core, oldsp);
-    la64_push(core, core->rl[LA64_REGISTER_FP]);
-    la64_push(core, core->rl[LA64_REGISTER_CF]);
-    la64_push(core, core->rl[LA64_REGISTER_R0]);
-    la64_push(core, core->rl[LA64_REGISTER_R1]);
-    la64_push(core, core->rl[LA64_REGISTER_R2]);
-    la64_push(core, core->rl[LA64_REGISTER_R3]);
-    la64_push(core, core->rl[LA64_REGISTER_R4]);
-    la64_push(core, core->rl[LA64_REGISTER_R5]);
-    la64_push(core, core->rl[LA64_REGISTER_R6]);
-    la64_push(core, core->rl[LA64_REGISTER_R7]);
-    la64_push(core, core->rl[LA64_REGISTER_R8]);
-    la64_push(core, core->rl[LA64_REGISTER_R9]);
-    la64_push(core, core->rl[LA64_REGISTER_R10]);
-    la64_push(core, core->rl[LA64_REGISTER_R11]);
+    /* accounted to the elevation that got interrupted */
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_INTERRUPTS);
+
+    if(banked)
+    {
+        /* interrupted context goes to the shadow bank, the handler gets its own registers back */
+        la64_swap_bank(core);
+
+        core->rl[LA64_REGISTER_CR0] = LA64_ELEVATION_KERNEL;
+        core->rl[LA64_REGISTER_SP] = core->rl[LA64_REGISTER_CR1];
+    }
+    else
+    {
+        /* jump to handler */
+        uint64_t oldsp = core->rl[LA64_REGISTER_SP];
+        uint64_t oldel = core->rl[LA64_REGISTER_CR0];
+
+        core->rl[LA64_REGISTER_CR0] = LA64_ELEVATION_KERNEL;
+
+        /* preempting a handler stacks the frame on top of its own */
+        if(!core->in_interrupt)
+        {
+            core->rl[LA64_REGISTER_SP] = core->rl[LA64_REGISTER_CR1];
+        }
+
+        /* creating interrupt stack frame */
+        la64_push(core, oldel);
+        la64_push(core, core->rl[LA64_REGISTER_PC]);
+        la64_push(core, oldsp);
+        la64_push(core, core->rl[LA64_REGISTER_FP]);
+        la64_push(core, core->rl[LA64_REGISTER_CF]);
+        la64_push(core, core->rl[LA64_REGISTER_R0]);
+        la64_push(core, core->rl[LA64_REGISTER_R1]);
+        la64_push(core, core->rl[LA64_REGISTER_R2]);
+        la64_push(core, core->rl[LA64_REGISTER_R3]);
+        la64_push(core, core->rl[LA64_REGISTER_R4]);
+        la64_push(core, core->rl[LA64_REGISTER_R5]);
+        la64_push(core, core->rl[LA64_REGISTER_R6]);
+        la64_push(core, core->rl[LA64_REGISTER_R7]);
+        la64_push(core, core->rl[LA64_REGISTER_R8]);
+        la64_push(core, core->rl[LA64_REGISTER_R9]);
+        la64_push(core, core->rl[LA64_REGISTER_R10]);
+        la64_push(core, core->rl[LA64_REGISTER_R11]);
+    }
 
     /* storing it as frame pointer  */
     core->rl[LA64_REGISTER_FP] = core->rl[LA64_REGISTER_SP];
@@ -202,10 +287,29 @@ uint64_t la64_intc_read(la64_core_t *core, void *device, uint64_t offset, int si
 {
     la64_intc_t *intc = (la64_intc_t *)device;
 
+    /* priorities are bytes, wider accesses cover several lines */
+    if(offset >= LA64_INTC_REG_PRIORITY &&
+       offset < LA64_INTC_REG_ROUTE)
+    {
+        uint64_t value = 0;
+
+        for(int i = 0; i < size && offset + i < LA64_INTC_REG_ROUTE; i++)
+        {
+            value |= (uint64_t)intc->priority[offset - LA64_INTC_REG_PRIORITY + i] << (i * 8);
+        }
+
+        return value;
+    }
+
+    if(offset >= LA64_INTC_REG_ROUTE)
+    {
+        return intc->route[(offset - LA64_INTC_REG_ROUTE) / 8];
+    }
+
     switch(offset)
     {
         case LA64_INTC_REG_PENDING:
-            return intc->pending; 
+            return __atomic_load_n(&intc->pending, __ATOMIC_ACQUIRE);
         case LA64_INTC_REG_ENABLED:
             return intc->enabled;
         case LA64_INTC_REG_CTRL:
@@ -214,6 +318,10 @@ uint64_t la64_intc_read(la64_core_t *core, void *device, uint64_t offset, int si
             return intc->vector_base;
         case LA64_INTC_REG_CURRENT:
             return (uint64_t)intc->current_irq;
+        case LA64_INTC_REG_THRESHOLD:
+            return intc->threshold;
+        case LA64_INTC_REG_RUNNING:
+            return intc_running_priority(intc);
         default:
             return 0;
     }
@@ -222,10 +330,27 @@ uint64_t la64_intc_read(la64_core_t *core, void *device, uint64_t offset, int si
 void la64_intc_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size)
 {
     la64_intc_t *intc = (la64_intc_t *)device;
+
+    if(offset >= LA64_INTC_REG_PRIORITY &&
+       offset < LA64_INTC_REG_ROUTE)
+    {
+        for(int i = 0; i < size && offset + i < LA64_INTC_REG_ROUTE; i++)
+        {
+            uint8_t prio = (uint8_t)(value >> (i * 8));
+            intc->priority[offset - LA64_INTC_REG_PRIORITY + i] = (prio > LA64_INTC_PRIO_MAX) ? LA64_INTC_PRIO_MAX : prio;
+        }
+        return;
+    }
+
+    if(offset >= LA64_INTC_REG_ROUTE)
+    {
+        intc->route[(offset - LA64_INTC_REG_ROUTE) / 8] = value;
+        return;
+    }
     
     switch (offset) {
         case LA64_INTC_REG_PENDING:
-            intc->pending &= ~value;
+            __atomic_fetch_and(&intc->pending, ~value, __ATOMIC_RELEASE);
             break;
         case LA64_INTC_REG_ENABLED:
             intc->enabled = value;
@@ -237,11 +362,17 @@ void la64_intc_write(la64_core_t *core, void *device, uint64_t offset, uint64_t
             intc->vector_base = value;
             break;
         case LA64_INTC_REG_ACK:
-            if((int64_t)value == intc->current_irq)
+            /* acking lets equal and lower priorities through before iret */
+            if(intc->depth > 0 &&
+               (int64_t)value == intc->active[intc->depth - 1].irq)
             {
+                intc->active[intc->depth - 1].priority = 0;
                 intc->current_irq = -1;
             }
             break;
+        case LA64_INTC_REG_THRESHOLD:
+            intc->threshold = value;
+            break;
         default:
             break;
     }
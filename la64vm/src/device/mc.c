@@ -33,6 +33,42 @@ uint64_t la64_mc_read(la64_core_t *core,
                       uint64_t offset,
                       int size)
 {
-    /* returning memory size */
-    return core->machine->memory->memory_size;
+    la64_memory_t *memory = core->machine->memory;
+
+    switch(offset)
+    {
+        case LA64_MC_REG_SIZE:
+            return memory->memory_size;
+        case LA64_MC_REG_REGIONS:
+            return memory->region_cnt;
+        default:
+            break;
+    }
+
+    /* describing the extra regions so the guest finds them */
+    if(offset < LA64_MC_REG_REGION)
+    {
+        return 0;
+    }
+
+    uint64_t index = (offset - LA64_MC_REG_REGION) / LA64_MC_REGION_STRIDE;
+
+    if(index >= (uint64_t)memory->region_cnt)
+    {
+        return 0;
+    }
+
+    la64_memory_region_t *region = &memory->region[index];
+
+    switch((offset - LA64_MC_REG_REGION) % LA64_MC_REGION_STRIDE)
+    {
+        case 0x00:
+            return region->base;
+        case 0x08:
+            return region->size;
+        case 0x10:
+            return region->persistent ? LA64_MC_REGION_PERSISTENT : 0;
+        default:
+            return 0;
+    }
 }
\ No newline at end of file
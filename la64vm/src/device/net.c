@@ -0,0 +1,627 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif /* __linux__ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <la64vm/machine.h>
+#include <la64vm/memory.h>
+
+#include <la64vm/device/net.h>
+#include <la64vm/device/interrupt.h>
+
+#if !defined(__linux__)
+/* sendmmsg and recvmmsg are linux only, elsewhere they are emulated one frame at a time */
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif /* !__linux__ */
+
+static int net_send_batch(int fd,
+                          struct mmsghdr *msgs,
+                          unsigned int n)
+{
+#if defined(__linux__)
+    return sendmmsg(fd, msgs, n, 0);
+#else
+    unsigned int i = 0;
+
+    for(; i < n; i++)
+    {
+        ssize_t r = sendmsg(fd, &msgs[i].msg_hdr, 0);
+
+        if(r < 0)
+        {
+            return (i == 0) ? -1 : (int)i;
+        }
+
+        msgs[i].msg_len = (unsigned int)r;
+    }
+
+    return (int)i;
+#endif /* __linux__ */
+}
+
+static int net_recv_batch(int fd,
+                          struct mmsghdr *msgs,
+                          unsigned int n)
+{
+#if defined(__linux__)
+    return recvmmsg(fd, msgs, n, MSG_DONTWAIT, NULL);
+#else
+    unsigned int i = 0;
+
+    for(; i < n; i++)
+    {
+        ssize_t r = recvmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT);
+
+        if(r < 0)
+        {
+            return (i == 0) ? -1 : (int)i;
+        }
+
+        msgs[i].msg_len = (unsigned int)r;
+    }
+
+    return (int)i;
+#endif /* __linux__ */
+}
+
+static inline bool net_ring_valid(uint64_t size)
+{
+    return size != 0 && (size & (size - 1)) == 0;
+}
+
+static void net_irq(la64_net_t *net)
+{
+    if(!(net->ctrl & NET_CTRL_IRQ_EN))
+    {
+        return;
+    }
+
+    /* with a delay the timer gathers whatever completes until it fires */
+    if(net->irq_delay != 0)
+    {
+        if(!atomic_exchange(&net->irq_timer_armed, true))
+        {
+            la64_ioloop_arm_timer(net->machine->ioloop, net->irq_timer, (uint64_t)net->irq_delay * 1000ULL, 0);
+        }
+        return;
+    }
+
+    if(!atomic_exchange(&net->irq_sent, true))
+    {
+        la64_raise_interrupt(net->machine, LA64_IRQ_NETWORK);
+    }
+}
+
+static void net_irq_delayed(void *ctx)
+{
+    la64_net_t *net = (la64_net_t *)ctx;
+
+    atomic_store(&net->irq_timer_armed, false);
+
+    if(!atomic_exchange(&net->irq_sent, true))
+    {
+        la64_raise_interrupt(net->machine, LA64_IRQ_NETWORK);
+    }
+}
+
+static void net_desc_finish(la64_net_desc_t *desc,
+                            bool ok)
+{
+    /* the frame has to be there before the guest sees the status */
+    atomic_thread_fence(memory_order_release);
+    desc->status = ok ? NET_DESC_DONE : NET_DESC_ERROR;
+}
+
+static void net_rx_drop(la64_net_t *net)
+{
+    /* a zero length read still consumes the whole datagram */
+    for(int i = 0; i < NET_BATCH; i++)
+    {
+        if(recv(net->fd, NULL, 0, MSG_DONTWAIT) < 0)
+        {
+            break;
+        }
+
+        atomic_fetch_add(&net->rx_drops, 1);
+    }
+}
+
+static void net_rx_ready(void *ctx)
+{
+    la64_net_t *net = (la64_net_t *)ctx;
+
+    uint64_t size = net->rx_ring_size;
+
+    /* a disabled or broken ring loses frames like a nic with its link down */
+    if(!(net->ctrl & NET_CTRL_ENABLE) ||
+       !net_ring_valid(size))
+    {
+        net_rx_drop(net);
+        return;
+    }
+
+    uint64_t head = atomic_load(&net->rx_head);
+    uint64_t tail = atomic_load(&net->rx_tail);
+
+    if(head == tail)
+    {
+        /*
+         * parking until the guest posts buffers, frames wait
+         * in the socket and a full socket blocks the peer.
+         * the tail is checked again after publishing the stall
+         * so a racing post either sees it or gets seen here.
+         */
+        atomic_store(&net->rx_stalled, true);
+
+        if(atomic_load(&net->rx_tail) == head)
+        {
+            la64_ioloop_remove(net->machine->ioloop, net->rx_source);
+            net->rx_source = NULL;
+            return;
+        }
+
+        atomic_store(&net->rx_stalled, false);
+        tail = atomic_load(&net->rx_tail);
+    }
+
+    struct mmsghdr msgs[NET_BATCH];
+    struct iovec iov[NET_BATCH];
+    la64_net_desc_t *descs[NET_BATCH];
+    unsigned int n = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+
+    while(n < NET_BATCH &&
+          head + n != tail)
+    {
+        la64_net_desc_t *desc = la64_memory_map(net->machine, net->rx_ring_base + ((head + n) & (size - 1)) * sizeof(la64_net_desc_t), sizeof(la64_net_desc_t), true);
+
+        if(desc == NULL)
+        {
+            break;
+        }
+
+        /* read once, the guest may rewrite the descriptor while we receive */
+        uint64_t addr = desc->addr;
+        uint64_t len = desc->len;
+        void *buf = (len != 0 && len <= NET_MAX_FRAME) ? la64_memory_map(net->machine, addr, len, true) : NULL;
+
+        if(buf == NULL)
+        {
+            break;
+        }
+
+        descs[n] = desc;
+        iov[n].iov_base = buf;
+        iov[n].iov_len = len;
+        msgs[n].msg_hdr.msg_iov = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        n++;
+    }
+
+    /* a bad buffer is handed back with an error, the loop calls again for the rest */
+    if(n == 0)
+    {
+        la64_net_desc_t *desc = la64_memory_map(net->machine, net->rx_ring_base + (head & (size - 1)) * sizeof(la64_net_desc_t), sizeof(la64_net_desc_t), true);
+
+        if(desc != NULL)
+        {
+            net_desc_finish(desc, false);
+        }
+
+        atomic_store(&net->rx_head, head + 1);
+        atomic_fetch_or(&net->status, NET_STATUS_ERROR);
+        net_irq(net);
+        return;
+    }
+
+    int r = net_recv_batch(net->fd, msgs, n);
+
+    if(r <= 0)
+    {
+        return;
+    }
+
+    for(int i = 0; i < r; i++)
+    {
+        descs[i]->len = msgs[i].msg_len;
+        net_desc_finish(descs[i], !(msgs[i].msg_hdr.msg_flags & MSG_TRUNC));
+    }
+
+    atomic_store(&net->rx_head, head + r);
+    atomic_fetch_or(&net->status, NET_STATUS_RX_DONE);
+    net_irq(net);
+}
+
+static void net_tx_drain(la64_net_t *net)
+{
+    uint64_t mask = net->tx_ring_size - 1;
+
+    while(atomic_load(&net->tx_head) != atomic_load(&net->tx_tail))
+    {
+        uint64_t head = atomic_load(&net->tx_head);
+        uint64_t tail = atomic_load(&net->tx_tail);
+
+        struct mmsghdr msgs[NET_BATCH];
+        struct iovec iov[NET_BATCH];
+        la64_net_desc_t *descs[NET_BATCH];
+        unsigned int n = 0;
+
+        memset(msgs, 0, sizeof(msgs));
+
+        while(n < NET_BATCH &&
+              head + n != tail)
+        {
+            la64_net_desc_t *desc = la64_memory_map(net->machine, net->tx_ring_base + ((head + n) & mask) * sizeof(la64_net_desc_t), sizeof(la64_net_desc_t), true);
+
+            if(desc == NULL)
+            {
+                break;
+            }
+
+            /* read once, the guest may rewrite the descriptor while we send */
+            uint64_t addr = desc->addr;
+            uint64_t len = desc->len;
+            void *buf = (len != 0 && len <= NET_MAX_FRAME) ? la64_memory_map(net->machine, addr, len, false) : NULL;
+
+            if(buf == NULL)
+            {
+                break;
+            }
+
+            descs[n] = desc;
+            iov[n].iov_base = buf;
+            iov[n].iov_len = len;
+            msgs[n].msg_hdr.msg_name = &net->peer;
+            msgs[n].msg_hdr.msg_namelen = sizeof(net->peer);
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            n++;
+        }
+
+        int r = (n != 0 && net->fd >= 0) ? net_send_batch(net->fd, msgs, n) : -1;
+
+        if(r > 0)
+        {
+            for(int i = 0; i < r; i++)
+            {
+                net_desc_finish(descs[i], true);
+            }
+
+            atomic_store(&net->tx_head, head + r);
+        }
+        else
+        {
+            /* a bad descriptor or no peer listening costs the frame at the head */
+            la64_net_desc_t *desc = la64_memory_map(net->machine, net->tx_ring_base + (head & mask) * sizeof(la64_net_desc_t), sizeof(la64_net_desc_t), true);
+
+            if(desc != NULL)
+            {
+                net_desc_finish(desc, false);
+            }
+
+            atomic_fetch_or(&net->status, NET_STATUS_ERROR);
+            atomic_store(&net->tx_head, head + 1);
+        }
+    }
+
+    atomic_fetch_or(&net->status, NET_STATUS_TX_DONE);
+    net_irq(net);
+}
+
+static void *net_tx_thread(void *arg)
+{
+    la64_net_t *net = (la64_net_t *)arg;
+
+    while(atomic_load(&net->tx_running))
+    {
+        /* sleeping until the guest rings the doorbell */
+        pthread_mutex_lock(&net->tx_mutex);
+
+        while(atomic_load(&net->tx_running) &&
+              atomic_load(&net->tx_head) == atomic_load(&net->tx_tail))
+        {
+            pthread_cond_wait(&net->tx_cond, &net->tx_mutex);
+        }
+
+        pthread_mutex_unlock(&net->tx_mutex);
+
+        if(!atomic_load(&net->tx_running))
+        {
+            break;
+        }
+
+        net_tx_drain(net);
+    }
+
+    return NULL;
+}
+
+bool la64_net_attach(la64_net_t *net,
+                     const char *spec)
+{
+    /* unix:<local path>,<peer path> */
+    const char *comma = (strncmp(spec, "unix:", 5) == 0) ? strchr(spec + 5, ',') : NULL;
+
+    if(comma == NULL ||
+       (size_t)(comma - (spec + 5)) >= sizeof(net->local.sun_path) ||
+       strlen(comma + 1) >= sizeof(net->peer.sun_path))
+    {
+        fprintf(stderr, "[!] unknown network backend %s\n", spec);
+        return false;
+    }
+
+    net->local.sun_family = AF_UNIX;
+    memcpy(net->local.sun_path, spec + 5, comma - (spec + 5));
+    net->peer.sun_family = AF_UNIX;
+    strcpy(net->peer.sun_path, comma + 1);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    unlink(net->local.sun_path);
+
+    if(bind(fd, (struct sockaddr *)&net->local, sizeof(net->local)) != 0)
+    {
+        fprintf(stderr, "[!] failed to bind %s\n", net->local.sun_path);
+        close(fd);
+        return false;
+    }
+
+    /* deep socket queues so bursts do not stall the sender */
+    int buf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+
+    net->fd = fd;
+    net->rx_source = la64_ioloop_add_fd(net->machine->ioloop, fd, net_rx_ready, net);
+
+    return net->rx_source != NULL;
+}
+
+la64_net_t *la64_net_alloc(la64_machine_t *machine)
+{
+    /* allocate network device */
+    la64_net_t *net = calloc(1, sizeof(la64_net_t));
+
+    if(net == NULL)
+    {
+        return NULL;
+    }
+
+    /* register network MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_NET_BASE, LA64_NET_SIZE, net, la64_net_read, la64_net_write))
+    {
+        free(net);
+        return NULL;
+    }
+
+    net->machine = machine;
+    net->fd = -1;
+
+    net->irq_timer = la64_ioloop_add_timer(machine->ioloop, net_irq_delayed, net);
+
+    if(net->irq_timer == NULL)
+    {
+        free(net);
+        return NULL;
+    }
+
+    pthread_mutex_init(&net->tx_mutex, NULL);
+    pthread_cond_init(&net->tx_cond, NULL);
+    atomic_store(&net->tx_running, true);
+
+    if(pthread_create(&net->tx_thread, NULL, net_tx_thread, net) != 0)
+    {
+        pthread_cond_destroy(&net->tx_cond);
+        pthread_mutex_destroy(&net->tx_mutex);
+        la64_ioloop_remove(machine->ioloop, net->irq_timer);
+        free(net);
+        return NULL;
+    }
+
+    return net;
+}
+
+void la64_net_dealloc(la64_net_t *net)
+{
+    /* waking the transmitter so it notices */
+    pthread_mutex_lock(&net->tx_mutex);
+    atomic_store(&net->tx_running, false);
+    pthread_cond_broadcast(&net->tx_cond);
+    pthread_mutex_unlock(&net->tx_mutex);
+
+    pthread_join(net->tx_thread, NULL);
+
+    /* holding the loop so no callback is halfway through */
+    la64_ioloop_lock(net->machine->ioloop);
+    la64_ioloop_remove(net->machine->ioloop, net->rx_source);
+    la64_ioloop_remove(net->machine->ioloop, net->irq_timer);
+    net->rx_source = NULL;
+    net->irq_timer = NULL;
+    la64_ioloop_unlock(net->machine->ioloop);
+
+    if(net->fd >= 0)
+    {
+        close(net->fd);
+        unlink(net->local.sun_path);
+    }
+
+    pthread_cond_destroy(&net->tx_cond);
+    pthread_mutex_destroy(&net->tx_mutex);
+    free(net);
+}
+
+uint64_t la64_net_read(la64_core_t *core,
+                       void *device,
+                       uint64_t offset,
+                       int size)
+{
+    /* getting network device */
+    la64_net_t *net = (la64_net_t *)device;
+
+    /* perform read */
+    switch(offset)
+    {
+        case NET_REG_CTRL:
+            return net->ctrl;
+        case NET_REG_TX_RING_BASE:
+            return net->tx_ring_base;
+        case NET_REG_TX_RING_SIZE:
+            return net->tx_ring_size;
+        case NET_REG_TX_HEAD:
+            return atomic_load(&net->tx_head);
+        case NET_REG_TX_TAIL:
+            return atomic_load(&net->tx_tail);
+        case NET_REG_RX_RING_BASE:
+            return net->rx_ring_base;
+        case NET_REG_RX_RING_SIZE:
+            return net->rx_ring_size;
+        case NET_REG_RX_HEAD:
+            return atomic_load(&net->rx_head);
+        case NET_REG_RX_TAIL:
+            return atomic_load(&net->rx_tail);
+        case NET_REG_STATUS:
+            return atomic_load(&net->status) | ((net->fd >= 0) ? NET_STATUS_LINK : 0);
+        case NET_REG_IRQ_DELAY:
+            return net->irq_delay;
+        case NET_REG_RX_DROPS:
+            return atomic_load(&net->rx_drops);
+        default:
+            return 0;
+    }
+}
+
+void la64_net_write(la64_core_t *core,
+                    void *device,
+                    uint64_t offset,
+                    uint64_t value,
+                    int size)
+{
+    /* getting network device */
+    la64_net_t *net = (la64_net_t *)device;
+
+    /* rings can only be reconfigured while they are empty */
+    bool tx_idle = atomic_load(&net->tx_head) == atomic_load(&net->tx_tail);
+    bool rx_idle = atomic_load(&net->rx_head) == atomic_load(&net->rx_tail);
+
+    /* perform write */
+    switch(offset)
+    {
+        case NET_REG_CTRL:
+            net->ctrl = value;
+            return;
+        case NET_REG_TX_RING_BASE:
+            if(tx_idle)
+            {
+                net->tx_ring_base = value;
+            }
+            return;
+        case NET_REG_TX_RING_SIZE:
+            if(tx_idle)
+            {
+                net->tx_ring_size = value;
+            }
+            return;
+        case NET_REG_TX_TAIL:
+            /* a broken ring never reaches the transmitter */
+            if(!(net->ctrl & NET_CTRL_ENABLE) ||
+               !net_ring_valid(net->tx_ring_size) ||
+               value - atomic_load(&net->tx_head) > net->tx_ring_size)
+            {
+                atomic_fetch_or(&net->status, NET_STATUS_ERROR);
+                return;
+            }
+
+            pthread_mutex_lock(&net->tx_mutex);
+            atomic_store(&net->tx_tail, value);
+            pthread_cond_signal(&net->tx_cond);
+            pthread_mutex_unlock(&net->tx_mutex);
+            return;
+        case NET_REG_RX_RING_BASE:
+            if(rx_idle)
+            {
+                net->rx_ring_base = value;
+            }
+            return;
+        case NET_REG_RX_RING_SIZE:
+            if(rx_idle)
+            {
+                net->rx_ring_size = value;
+            }
+            return;
+        case NET_REG_RX_TAIL:
+            if(!net_ring_valid(net->rx_ring_size) ||
+               value - atomic_load(&net->rx_head) > net->rx_ring_size)
+            {
+                atomic_fetch_or(&net->status, NET_STATUS_ERROR);
+                return;
+            }
+
+            atomic_store(&net->rx_tail, value);
+
+            /* fresh buffers wake a parked receiver */
+            if(atomic_load(&net->rx_stalled))
+            {
+                /* under the loop, a parking receiver clears rx_source with it held */
+                la64_ioloop_lock(net->machine->ioloop);
+
+                if(atomic_exchange(&net->rx_stalled, false))
+                {
+                    net->rx_source = la64_ioloop_add_fd(net->machine->ioloop, net->fd, net_rx_ready, net);
+                }
+
+                la64_ioloop_unlock(net->machine->ioloop);
+            }
+            return;
+        case NET_REG_STATUS:
+            atomic_fetch_and(&net->status, ~(value & (NET_STATUS_TX_DONE | NET_STATUS_RX_DONE | NET_STATUS_ERROR)));
+
+            /* acking lets the next completion interrupt again */
+            atomic_store(&net->irq_sent, false);
+            return;
+        case NET_REG_IRQ_DELAY:
+            net->irq_delay = (uint32_t)value;
+            return;
+        default:
+            return;
+    }
+}
@@ -34,11 +34,38 @@
 
 uint64_t la64_platform_read(la64_core_t *core, void *device, uint64_t offset, int size)
 {
+    if(offset == PLATFORM_REG_EXIT)
+    {
+        return core->machine->exit_code;
+    }
+
+    if(offset == PLATFORM_REG_READY)
+    {
+        return core->machine->clone_id;
+    }
+
     return 1;
 }
 
 void la64_platform_write(la64_core_t *core, void *device, uint64_t offset, uint64_t value, int size)
 {
+    if(offset == PLATFORM_REG_EXIT)
+    {
+        core->machine->exit_code = value;
+        return;
+    }
+
+    if(offset == PLATFORM_REG_READY)
+    {
+        /* only a fork server stops here, everywhere else the guest just carries on */
+        if(core->machine->fork_server)
+        {
+            core->machine->ready = true;
+            la64_core_terminate(core->machine->core);
+        }
+        return;
+    }
+
     if(value == 0)
     {
         #if defined(__APPLE__)
@@ -0,0 +1,181 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <la64vm/machine.h>
+
+#include <la64vm/device/pmu.h>
+#include <la64vm/device/interrupt.h>
+
+la64_pmu_t *la64_pmu_alloc(la64_machine_t *machine)
+{
+    /* allocate performance monitoring unit */
+    la64_pmu_t *pmu = calloc(1, sizeof(la64_pmu_t));
+
+    if(pmu == NULL)
+    {
+        return NULL;
+    }
+
+    /* register pmu MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_PMU_BASE, LA64_PMU_SIZE, pmu, la64_pmu_read, la64_pmu_write))
+    {
+        free(pmu);
+        return NULL;
+    }
+
+    pmu->machine = machine;
+
+    return pmu;
+}
+
+void la64_pmu_dealloc(la64_pmu_t *pmu)
+{
+    free(pmu);
+}
+
+static void la64_pmu_update_active(la64_pmu_t *pmu)
+{
+    for(uint8_t el = 0; el < 4; el++)
+    {
+        pmu->active[el] = 0;
+
+        /* globally disabled means nothing counts anywhere */
+        if(!(pmu->ctrl & PMU_CTRL_ENABLE))
+        {
+            continue;
+        }
+
+        for(uint8_t i = 0; i < LA64_PMU_COUNTERS; i++)
+        {
+            if((pmu->cfg[i] & PMU_CFG_ENABLE) &&
+               (pmu->cfg[i] & (1u << (PMU_CFG_EL_SHIFT + el))))
+            {
+                pmu->active[el] |= (1u << i);
+            }
+        }
+    }
+}
+
+void la64_pmu_count(la64_pmu_t *pmu,
+                    uint8_t event)
+{
+    /* counting and checking for wrap around */
+    if(++(pmu->count[event]) != 0)
+    {
+        return;
+    }
+
+    /* the guest preloads counters with -N to get an interrupt every N events */
+    pmu->overflow |= (1ULL << event);
+
+    if(pmu->cfg[event] & PMU_CFG_IRQ_EN)
+    {
+        la64_raise_interrupt(pmu->machine, LA64_IRQ_PMU);
+    }
+}
+
+uint64_t la64_pmu_read(la64_core_t *core,
+                       void *device,
+                       uint64_t offset,
+                       int size)
+{
+    /* getting pmu */
+    la64_pmu_t *pmu = (la64_pmu_t *)device;
+
+    /* perform read */
+    switch(offset)
+    {
+        case PMU_REG_CTRL:
+            return pmu->ctrl;
+        case PMU_REG_OVERFLOW:
+            return pmu->overflow;
+        case PMU_REG_RESET:
+            /* write only */
+            return 0;
+        default:
+            break;
+    }
+
+    /* counter banks */
+    if(offset >= PMU_REG_COUNTER_CFG(0) &&
+       offset < PMU_REG_COUNTER_CFG(LA64_PMU_COUNTERS))
+    {
+        uint64_t idx = (offset - PMU_REG_COUNTER_CFG(0)) / 0x10;
+        return (offset & 0x8) ? pmu->count[idx] : pmu->cfg[idx];
+    }
+
+    return 0;
+}
+
+void la64_pmu_write(la64_core_t *core,
+                    void *device,
+                    uint64_t offset,
+                    uint64_t value,
+                    int size)
+{
+    /* getting pmu */
+    la64_pmu_t *pmu = (la64_pmu_t *)device;
+
+    /* perform write */
+    switch(offset)
+    {
+        case PMU_REG_CTRL:
+            pmu->ctrl = value;
+            la64_pmu_update_active(pmu);
+            return;
+        case PMU_REG_OVERFLOW:
+            pmu->overflow &= ~value;
+            return;
+        case PMU_REG_RESET:
+            for(uint8_t i = 0; i < LA64_PMU_COUNTERS; i++)
+            {
+                if(value & (1ULL << i))
+                {
+                    pmu->count[i] = 0;
+                }
+            }
+            return;
+        default:
+            break;
+    }
+
+    /* counter banks */
+    if(offset >= PMU_REG_COUNTER_CFG(0) &&
+       offset < PMU_REG_COUNTER_CFG(LA64_PMU_COUNTERS))
+    {
+        uint64_t idx = (offset - PMU_REG_COUNTER_CFG(0)) / 0x10;
+
+        if(offset & 0x8)
+        {
+            pmu->count[idx] = value;
+        }
+        else
+        {
+            pmu->cfg[idx] = value;
+            la64_pmu_update_active(pmu);
+        }
+    }
+}
@@ -0,0 +1,282 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include <la64vm/machine.h>
+#include <la64vm/mmu.h>
+
+#include <la64vm/device/shm.h>
+#include <la64vm/device/interrupt.h>
+
+static bool shm_peer_address(la64_shm_t *shm,
+                             uint64_t id,
+                             struct sockaddr_un *addr)
+{
+    /* every peer of a segment finds the others by name and id */
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+
+    int len = snprintf(addr->sun_path, sizeof(addr->sun_path), "/tmp/la64-shm-%s.%llu", shm->name, (unsigned long long)id);
+
+    return len > 0 && (size_t)len < sizeof(addr->sun_path);
+}
+
+static void shm_doorbell_ready(void *ctx)
+{
+    la64_shm_t *shm = ctx;
+    uint8_t vector = 0;
+
+    /* gathering everything rung since the last wakeup */
+    while(recv(shm->fd, &vector, sizeof(vector), MSG_DONTWAIT) == sizeof(vector))
+    {
+        if(vector < SHM_MAX_VECTORS)
+        {
+            atomic_fetch_or(&shm->pending, 1ULL << vector);
+        }
+    }
+
+    if((shm->ctrl & SHM_CTRL_IRQ_EN) &&
+       atomic_load(&shm->pending) != 0)
+    {
+        la64_raise_interrupt(shm->machine, LA64_IRQ_SHM);
+    }
+}
+
+bool la64_shm_attach(la64_shm_t *shm,
+                     const char *spec)
+{
+    /* <name>,<size>,<id> */
+    const char *comma = strchr(spec, ',');
+
+    if(comma == NULL ||
+       comma == spec ||
+       (size_t)(comma - spec) >= sizeof(shm->name) ||
+       memchr(spec, '/', comma - spec) != NULL)
+    {
+        fprintf(stderr, "[!] unknown shared memory spec %s\n", spec);
+        return false;
+    }
+
+    memcpy(shm->name, spec, comma - spec);
+
+    char *end = NULL;
+    uint64_t size = strtoull(comma + 1, &end, 0);
+    uint64_t id = (*end == ',') ? strtoull(end + 1, NULL, 0) : SHM_MAX_PEERS;
+
+    if(size == 0 ||
+       (size & (LA64_MMU_PAGE_SIZE - 1)) ||
+       id >= SHM_MAX_PEERS ||
+       !shm_peer_address(shm, id, &shm->local))
+    {
+        fprintf(stderr, "[!] unknown shared memory spec %s\n", spec);
+        return false;
+    }
+
+    /* the doorbell first, the window is only registered once nothing can fail anymore */
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    unlink(shm->local.sun_path);
+
+    if(bind(fd, (struct sockaddr *)&shm->local, sizeof(shm->local)) != 0)
+    {
+        fprintf(stderr, "[!] failed to bind %s\n", shm->local.sun_path);
+        close(fd);
+        return false;
+    }
+
+    /* whoever comes first creates the segment, the rest map what is there */
+    char shm_path[80];
+    snprintf(shm_path, sizeof(shm_path), "/la64-%s", shm->name);
+
+    int memfd = shm_open(shm_path, O_RDWR | O_CREAT, 0600);
+
+    if(memfd < 0)
+    {
+        fprintf(stderr, "[!] failed to open shared memory %s\n", shm_path);
+        goto out_close;
+    }
+
+    struct stat memfd_stat;
+
+    if(fstat(memfd, &memfd_stat) != 0 ||
+       ((uint64_t)memfd_stat.st_size < size && ftruncate(memfd, size) != 0))
+    {
+        fprintf(stderr, "[!] failed to size shared memory %s\n", shm_path);
+        close(memfd);
+        goto out_close;
+    }
+
+    uint8_t *ram = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+
+    if(ram == MAP_FAILED)
+    {
+        goto out_close;
+    }
+
+    /* plain ram to the guest, stores land in the peers right away */
+    if(!la64_mmio_register_ram(shm->machine->mmio_bus, LA64_SHM_RAM_BASE, size, ram, NULL, 0))
+    {
+        munmap(ram, size);
+        goto out_close;
+    }
+
+    shm->ram = ram;
+    shm->ram_size = size;
+    shm->id = id;
+    shm->fd = fd;
+    shm->source = la64_ioloop_add_fd(shm->machine->ioloop, fd, shm_doorbell_ready, shm);
+
+    return shm->source != NULL;
+
+out_close:
+    close(fd);
+    unlink(shm->local.sun_path);
+    return false;
+}
+
+la64_shm_t *la64_shm_alloc(la64_machine_t *machine)
+{
+    /* allocate shared memory device */
+    la64_shm_t *shm = calloc(1, sizeof(la64_shm_t));
+
+    if(shm == NULL)
+    {
+        return NULL;
+    }
+
+    /* register shared memory MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_SHM_BASE, LA64_SHM_SIZE, shm, la64_shm_read, la64_shm_write))
+    {
+        free(shm);
+        return NULL;
+    }
+
+    shm->machine = machine;
+    shm->fd = -1;
+
+    return shm;
+}
+
+void la64_shm_dealloc(la64_shm_t *shm)
+{
+    la64_ioloop_remove(shm->machine->ioloop, shm->source);
+    shm->source = NULL;
+
+    if(shm->fd >= 0)
+    {
+        close(shm->fd);
+        unlink(shm->local.sun_path);
+    }
+
+    /* the segment it self stays for peers still running, shm_unlink removes it */
+    if(shm->ram != NULL)
+    {
+        munmap(shm->ram, shm->ram_size);
+    }
+
+    free(shm);
+}
+
+uint64_t la64_shm_read(la64_core_t *core,
+                       void *device,
+                       uint64_t offset,
+                       int size)
+{
+    la64_shm_t *shm = (la64_shm_t *)device;
+
+    switch(offset)
+    {
+        case SHM_REG_ID:
+            return shm->id;
+        case SHM_REG_RAM_BASE:
+            return LA64_SHM_RAM_BASE;
+        case SHM_REG_RAM_SIZE:
+            return shm->ram_size;
+        case SHM_REG_PENDING:
+            return atomic_load(&shm->pending);
+        case SHM_REG_CTRL:
+            return shm->ctrl;
+        default:
+            return 0;
+    }
+}
+
+void la64_shm_write(la64_core_t *core,
+                    void *device,
+                    uint64_t offset,
+                    uint64_t value,
+                    int size)
+{
+    la64_shm_t *shm = (la64_shm_t *)device;
+
+    switch(offset)
+    {
+        case SHM_REG_DOORBELL:
+        {
+            uint64_t peer = value >> 8;
+            uint8_t vector = value & 0xFF;
+            struct sockaddr_un addr;
+
+            /* a peer that is not up yet simply misses the ring */
+            if(shm->fd >= 0 &&
+               peer < SHM_MAX_PEERS &&
+               vector < SHM_MAX_VECTORS &&
+               shm_peer_address(shm, peer, &addr))
+            {
+                sendto(shm->fd, &vector, sizeof(vector), MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr));
+            }
+            return;
+        }
+        case SHM_REG_PENDING:
+            atomic_fetch_and(&shm->pending, ~value);
+            return;
+        case SHM_REG_CTRL:
+            shm->ctrl = value;
+
+            /* enabling with vectors already waiting interrupts right away */
+            if((shm->ctrl & SHM_CTRL_IRQ_EN) &&
+               atomic_load(&shm->pending) != 0)
+            {
+                la64_raise_interrupt(shm->machine, LA64_IRQ_SHM);
+            }
+            return;
+        default:
+            return;
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <la64vm/machine.h>
+
+#include <la64vm/device/timepage.h>
+#include <la64vm/device/timer.h>
+
+static void timepage_write_begin(la64_timepage_data_t *data)
+{
+    __atomic_store_n(&data->seq, data->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void timepage_write_end(la64_timepage_data_t *data)
+{
+    __atomic_store_n(&data->seq, data->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void timepage_set_wall(la64_timepage_t *tp,
+                              uint64_t host_cycles)
+{
+    la64_timepage_data_t *data = tp->data;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    /* walking the wall clock back to counter 0 */
+    uint64_t counter = host_cycles - tp->boot_cycles;
+    uint64_t now_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    uint64_t since_ns = (uint64_t)((double)counter * 1e9 / (double)data->freq);
+    uint64_t base_ns = now_ns - since_ns;
+
+    timepage_write_begin(data);
+    data->counter = counter;
+    data->wall_sec = base_ns / 1000000000ULL;
+    data->wall_nsec = base_ns % 1000000000ULL;
+    timepage_write_end(data);
+
+    tp->next_wall = host_cycles + data->freq;
+}
+
+void la64_timepage_update(la64_timepage_t *tp,
+                          uint64_t host_cycles)
+{
+    tp->next_update = host_cycles + tp->interval;
+
+    if(host_cycles >= tp->next_wall)
+    {
+        timepage_set_wall(tp, host_cycles);
+        return;
+    }
+
+    /* a single store, guests never see it torn */
+    timepage_write_begin(tp->data);
+    tp->data->counter = host_cycles - tp->boot_cycles;
+    timepage_write_end(tp->data);
+}
+
+void la64_timepage_rebase(la64_timepage_t *tp,
+                          uint64_t boot_cycles)
+{
+    uint64_t host_cycles = la64_get_host_cycles();
+
+    /* counting from another machines counter 0 */
+    tp->boot_cycles = boot_cycles;
+
+    timepage_set_wall(tp, host_cycles);
+    tp->next_update = host_cycles + tp->interval;
+}
+
+la64_timepage_t *la64_timepage_alloc(la64_machine_t *machine)
+{
+    /* allocate time page */
+    la64_timepage_t *tp = calloc(1, sizeof(la64_timepage_t));
+
+    if(tp == NULL)
+    {
+        return NULL;
+    }
+
+    tp->ram = calloc(1, LA64_TIMEPAGE_SIZE);
+
+    if(tp->ram == NULL)
+    {
+        free(tp);
+        return NULL;
+    }
+
+    /* guests load straight from it but cannot store */
+    if(!la64_mmio_register_rom(machine->mmio_bus, LA64_TIMEPAGE_BASE, LA64_TIMEPAGE_SIZE, tp->ram))
+    {
+        free(tp->ram);
+        free(tp);
+        return NULL;
+    }
+
+    tp->data = (la64_timepage_data_t *)tp->ram;
+    tp->data->freq = machine->timer->host_freq;
+    tp->data->resolution_ns = LA64_TIMEPAGE_RES_NS;
+
+    tp->interval = (uint64_t)((double)machine->timer->host_freq * LA64_TIMEPAGE_RES_NS / 1e9);
+    tp->boot_cycles = la64_get_host_cycles();
+
+    timepage_set_wall(tp, tp->boot_cycles);
+    tp->next_update = tp->boot_cycles + tp->interval;
+
+    return tp;
+}
+
+void la64_timepage_dealloc(la64_timepage_t *tp)
+{
+    free(tp->ram);
+    free(tp);
+}
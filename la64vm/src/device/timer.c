@@ -24,8 +24,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <la64vm/machine.h>
 
@@ -96,90 +98,283 @@ static uint64_t detect_host_freq(void)
 #endif
 }
 
-la64_timer_t *la64_timer_alloc(la64_machine_t *machine)
+/* the host clock is the same for every machine, measuring it once is enough */
+static pthread_once_t host_freq_once = PTHREAD_ONCE_INIT;
+static uint64_t host_freq;
+
+static void host_freq_init(void)
 {
-    /* allocate timer */
-    la64_timer_t *timer = malloc(sizeof(la64_timer_t));
+    host_freq = detect_host_freq();
+}
 
-    if(timer == NULL)
+static uint64_t timer_count(la64_timer_channel_t *ch,
+                            uint64_t now)
+{
+    if(!(ch->ctrl & TIMER_CTRL_ENABLE))
     {
-        return NULL;
+        return ch->count;
     }
 
-    /* register timer MMIO */
-    if(!la64_mmio_register(machine->mmio_bus, LA64_TIMER_BASE, LA64_TIMER_SIZE, timer, la64_timer_read, la64_timer_write))
-    {
-        free(timer);
-        return NULL;
-    }
+    return ch->count + (now - ch->base_cycles);
+}
 
-    /* setting up timer */
-    timer->machine = machine;
-    timer->compare = UINT64_MAX;
-    
-    timer->host_freq = detect_host_freq();
-    timer->last_host_cycles = la64_get_host_cycles();
-    
-    return timer;
+static void timer_rebase(la64_timer_channel_t *ch,
+                         uint64_t now)
+{
+    ch->count = timer_count(ch, now);
+    ch->base_cycles = now;
 }
 
-void la64_timer_dealloc(la64_timer_t *timer)
+static void timer_heap_swap(la64_timer_t *timer,
+                            int a,
+                            int b)
 {
-    free(timer);
+    int t = timer->heap[a];
+    timer->heap[a] = timer->heap[b];
+    timer->heap[b] = t;
+
+    timer->channels[timer->heap[a]].heap_index = a;
+    timer->channels[timer->heap[b]].heap_index = b;
 }
 
-void la64_timer_tick(la64_timer_t *timer,
-                     uint64_t host_cycles)
+static void timer_heap_sift(la64_timer_t *timer,
+                            int i)
 {
-    /* checking if timer is not enabled */
-    if(!(timer->ctrl & TIMER_CTRL_ENABLE))
+    /* up while earlier than the parent */
+    while(i > 0 &&
+          timer->channels[timer->heap[i]].deadline < timer->channels[timer->heap[(i - 1) / 2]].deadline)
     {
-        /* if it is then we simply forget about it!!! */
-        timer->last_host_cycles = host_cycles;
-        return;
+        timer_heap_swap(timer, i, (i - 1) / 2);
+        i = (i - 1) / 2;
     }
-    
-    /* calculate elappsed cycles */
-    uint64_t elapsed_host = host_cycles - timer->last_host_cycles;
-    timer->last_host_cycles = host_cycles;
 
-    if (elapsed_host == 0)
+    /* down while later than a child */
+    for(;;)
+    {
+        int min = i;
+        int l = 2 * i + 1;
+        int r = 2 * i + 2;
+
+        if(l < timer->heap_len &&
+           timer->channels[timer->heap[l]].deadline < timer->channels[timer->heap[min]].deadline)
+        {
+            min = l;
+        }
+
+        if(r < timer->heap_len &&
+           timer->channels[timer->heap[r]].deadline < timer->channels[timer->heap[min]].deadline)
+        {
+            min = r;
+        }
+
+        if(min == i)
+        {
+            break;
+        }
+
+        timer_heap_swap(timer, i, min);
+        i = min;
+    }
+}
+
+static void timer_heap_remove(la64_timer_t *timer,
+                              la64_timer_channel_t *ch)
+{
+    int i = ch->heap_index;
+
+    if(i < 0)
     {
         return;
     }
 
-    /*  calculating using virtual frequency the actual timer count */
-    uint64_t virtual_ticks = elapsed_host;
-    
-    /* null check */
-    if(virtual_ticks == 0)
+    timer->heap_len--;
+
+    if(i != timer->heap_len)
     {
+        timer_heap_swap(timer, i, timer->heap_len);
+        timer_heap_sift(timer, i);
+    }
+
+    ch->heap_index = -1;
+}
+
+static void timer_arm(la64_timer_t *timer,
+                      uint64_t now)
+{
+    if(timer->heap_len == 0)
+    {
+        la64_ioloop_arm_timer(timer->machine->ioloop, timer->source, 0, 0);
         return;
     }
-    
-    /* updating timer */
-    uint64_t old_count = timer->count;
-    timer->count += virtual_ticks;
-    
-    /* compare match */
-    if(old_count < timer->compare && timer->count >= timer->compare)
+
+    uint64_t deadline = timer->channels[timer->heap[0]].deadline;
+    uint64_t cycles = (deadline > now) ? deadline - now : 0;
+
+    /* a first expiry of 0 would disarm, so a due match waits one nanosecond */
+    uint64_t ns = (uint64_t)((double)cycles * 1e9 / (double)timer->host_freq);
+
+    la64_ioloop_arm_timer(timer->machine->ioloop, timer->source, ns ? ns : 1, 0);
+}
+
+static void timer_schedule(la64_timer_t *timer,
+                           la64_timer_channel_t *ch,
+                           uint64_t now)
+{
+    /* called with the timer mutex held and the channel rebased to now */
+    timer_heap_remove(timer, ch);
+
+    /* only a count below compare ever matches, like the ticked timer did */
+    if((ch->ctrl & TIMER_CTRL_ENABLE) &&
+       ch->count < ch->compare)
+    {
+        ch->deadline = ch->base_cycles + (ch->compare - ch->count);
+        ch->heap_index = timer->heap_len;
+        timer->heap[timer->heap_len++] = (int)(ch - timer->channels);
+        timer_heap_sift(timer, ch->heap_index);
+    }
+
+    timer_arm(timer, now);
+}
+
+static void timer_expired(void *ctx)
+{
+    la64_timer_t *timer = (la64_timer_t *)ctx;
+
+    /* the loop mutex is held too, it is always taken before the timer mutex */
+    pthread_mutex_lock(&timer->mutex);
+
+    uint64_t now = la64_get_host_cycles();
+
+    while(timer->heap_len != 0 &&
+          timer->channels[timer->heap[0]].deadline <= now)
     {
-        timer->status |= TIMER_STATUS_IRQ;
-        
-        if(timer->ctrl & TIMER_CTRL_PERIODIC)
+        la64_timer_channel_t *ch = &timer->channels[timer->heap[0]];
+
+        ch->status |= TIMER_STATUS_IRQ;
+
+        timer_heap_remove(timer, ch);
+
+        if((ch->ctrl & TIMER_CTRL_PERIODIC) &&
+           ch->compare != 0)
         {
-            timer->count -= timer->compare;
+            /* every period missed since the deadline at once, and one irq for all of them */
+            uint64_t period = (ch->compare > timer->min_period) ? ch->compare : timer->min_period;
+            uint64_t missed = (now - ch->deadline) / period + 1;
+
+            ch->deadline += missed * period;
+            ch->base_cycles = ch->deadline - period;
+            ch->count = 0;
+
+            ch->heap_index = timer->heap_len;
+            timer->heap[timer->heap_len++] = (int)(ch - timer->channels);
+            timer_heap_sift(timer, ch->heap_index);
         }
         else
         {
-            timer->ctrl &= ~TIMER_CTRL_ENABLE;
+            /* the count matched compare exactly at the deadline */
+            ch->count = ch->compare;
+            ch->base_cycles = ch->deadline;
+            timer_rebase(ch, now);
+            ch->ctrl &= ~TIMER_CTRL_ENABLE;
         }
-        
-        if(timer->ctrl & TIMER_CTRL_IRQ_EN)
+
+        if(ch->ctrl & TIMER_CTRL_IRQ_EN)
         {
             la64_raise_interrupt(timer->machine, LA64_IRQ_TIMER);
         }
     }
+
+    timer_arm(timer, now);
+
+    pthread_mutex_unlock(&timer->mutex);
+}
+
+la64_timer_t *la64_timer_alloc(la64_machine_t *machine)
+{
+    /* allocate timer */
+    la64_timer_t *timer = calloc(1, sizeof(la64_timer_t));
+
+    if(timer == NULL)
+    {
+        return NULL;
+    }
+
+    /* register timer MMIO */
+    if(!la64_mmio_register(machine->mmio_bus, LA64_TIMER_BASE, LA64_TIMER_SIZE, timer, la64_timer_read, la64_timer_write))
+    {
+        free(timer);
+        return NULL;
+    }
+
+    pthread_mutex_init(&timer->mutex, NULL);
+
+    /* compare matches fire from the io loop, not from the core */
+    timer->source = la64_ioloop_add_timer(machine->ioloop, timer_expired, timer);
+
+    if(timer->source == NULL)
+    {
+        pthread_mutex_destroy(&timer->mutex);
+        free(timer);
+        return NULL;
+    }
+
+    /* setting up timer */
+    timer->machine = machine;
+
+    for(int i = 0; i < LA64_TIMER_CHANNELS; i++)
+    {
+        timer->channels[i].compare = UINT64_MAX;
+        timer->channels[i].heap_index = -1;
+    }
+
+    pthread_once(&host_freq_once, host_freq_init);
+    timer->host_freq = host_freq;
+    timer->min_period = host_freq / 1000000;
+    
+    return timer;
+}
+
+void la64_timer_dealloc(la64_timer_t *timer)
+{
+    /* no match runs once it returns, callbacks hold the loop */
+    la64_ioloop_remove(timer->machine->ioloop, timer->source);
+
+    pthread_mutex_destroy(&timer->mutex);
+    free(timer);
+}
+
+void la64_timer_save(la64_timer_t *timer,
+                     la64_timer_channel_t *channels)
+{
+    pthread_mutex_lock(&timer->mutex);
+    memcpy(channels, timer->channels, sizeof(timer->channels));
+    pthread_mutex_unlock(&timer->mutex);
+}
+
+void la64_timer_restore(la64_timer_t *timer,
+                        const la64_timer_channel_t *channels)
+{
+    pthread_mutex_lock(&timer->mutex);
+
+    uint64_t now = la64_get_host_cycles();
+
+    /* bases are host cycles, so running channels just carry on */
+    for(int i = 0; i < LA64_TIMER_CHANNELS; i++)
+    {
+        la64_timer_channel_t *ch = &timer->channels[i];
+
+        timer_heap_remove(timer, ch);
+
+        ch->ctrl = channels[i].ctrl;
+        ch->count = channels[i].count;
+        ch->base_cycles = channels[i].base_cycles;
+        ch->compare = channels[i].compare;
+        ch->status = channels[i].status;
+
+        timer_schedule(timer, ch, now);
+    }
+
+    pthread_mutex_unlock(&timer->mutex);
 }
 
 uint64_t la64_timer_read(la64_core_t *core,
@@ -187,25 +382,48 @@ uint64_t la64_timer_read(la64_core_t *core,
                          uint64_t offset,
                          int size)
 {
-    /* getting timer */
+    /* getting timer and channel */
     la64_timer_t *timer = (la64_timer_t *)device;
+    la64_timer_channel_t *ch = &timer->channels[offset / LA64_TIMER_CHANNEL_SIZE];
+
+    uint64_t value = 0;
+
+    pthread_mutex_lock(&timer->mutex);
 
     /* perform read */
-    switch(offset)
+    switch(offset % LA64_TIMER_CHANNEL_SIZE)
     {
         case TIMER_REG_CTRL:
-            return timer->ctrl;
+            value = ch->ctrl;
+            break;
         case TIMER_REG_COUNT:
-            return timer->count;
+            value = timer_count(ch, la64_get_host_cycles());
+            break;
         case TIMER_REG_COMPARE:
-            return timer->compare;
+            value = ch->compare;
+            break;
         case TIMER_REG_STATUS:
-            return timer->status;
+            value = ch->status;
+            break;
         case TIMER_REG_FREQ:
-            return timer->host_freq;
+            value = timer->host_freq;
+            break;
+        case TIMER_REG_PENDING:
+            for(int i = 0; i < LA64_TIMER_CHANNELS; i++)
+            {
+                if(timer->channels[i].status & TIMER_STATUS_IRQ)
+                {
+                    value |= (1ULL << i);
+                }
+            }
+            break;
         default:
-            return 0;
+            break;
     }
+
+    pthread_mutex_unlock(&timer->mutex);
+
+    return value;
 }
 
 void la64_timer_write(la64_core_t *core,
@@ -214,32 +432,43 @@ void la64_timer_write(la64_core_t *core,
                       uint64_t value,
                       int size)
 {
-    /* getting timer */
+    /* getting timer and channel */
     la64_timer_t *timer = (la64_timer_t *)device;
+    la64_timer_channel_t *ch = &timer->channels[offset / LA64_TIMER_CHANNEL_SIZE];
+
+    pthread_mutex_lock(&timer->mutex);
+
+    uint64_t now = la64_get_host_cycles();
 
     /* perform write */
-    switch(offset)
+    switch(offset % LA64_TIMER_CHANNEL_SIZE)
     {
         case TIMER_REG_CTRL:
-            timer->ctrl = value;
-            if(value & TIMER_CTRL_ENABLE)
-            {
-                timer->last_host_cycles = la64_get_host_cycles();
-            }
+            /* freezing or resuming the count where it is */
+            timer_rebase(ch, now);
+            ch->ctrl = value;
+            timer_schedule(timer, ch, now);
             break;
         case TIMER_REG_COUNT:
-            timer->count = value;
+            ch->count = value;
+            ch->base_cycles = now;
+            timer_schedule(timer, ch, now);
             break;
         case TIMER_REG_COMPARE:
-            timer->compare = value;
+            timer_rebase(ch, now);
+            ch->compare = value;
+            timer_schedule(timer, ch, now);
             break;
         case TIMER_REG_STATUS:
-            timer->status &= ~value;
+            ch->status &= ~value;
             break;
         case TIMER_REG_FREQ:
+        case TIMER_REG_PENDING:
             /* Read-only */
             break;
         default:
             break;
     }
+
+    pthread_mutex_unlock(&timer->mutex);
 }
@@ -22,37 +22,78 @@
  * SOFTWARE.
  */
 
+/* pty functions are xsi */
+#define _GNU_SOURCE
+
 #include <la64vm/machine.h>
 #include <la64vm/device/uart.h>
 #include <la64vm/device/interrupt.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
 #include <termios.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
-static struct termios uart_orig_termios;
-
-static void uart_set_raw_mode(void)
+static void uart_set_raw_mode(la64_uart_t *u)
 {
+    /* nothing to restore later if stdin is not a terminal */
+    if(tcgetattr(STDIN_FILENO, &u->orig_termios) != 0)
+    {
+        return;
+    }
+
     /* TODO: make this rawer, or make a GUI terminal */
-    struct termios raw;
-    tcgetattr(STDIN_FILENO, &uart_orig_termios);
-    raw = uart_orig_termios;
+    struct termios raw = u->orig_termios;
     raw.c_lflag &= ~(ICANON | ECHO);
     raw.c_cc[VMIN] = 1;
     raw.c_cc[VTIME] = 0;
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    u->raw_mode = true;
+}
+
+static void uart_restore_mode(la64_uart_t *u)
+{
+    if(u->raw_mode)
+    {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &u->orig_termios);
+        u->raw_mode = false;
+    }
+}
+
+static inline uint32_t uart_rx_level(la64_uart_t *u)
+{
+    return atomic_load(&u->rx_tail) - atomic_load(&u->rx_head);
 }
 
-static void uart_restore_mode(void)
+static uint32_t uart_status(la64_uart_t *u)
 {
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &uart_orig_termios);
+    uint32_t level = uart_rx_level(u);
+    uint32_t status = atomic_load(&u->status) | UART_STATUS_TX_EMPTY;
+
+    if(level != 0)
+    {
+        status |= UART_STATUS_RX_READY;
+    }
+
+    if(level > (UART_BUF_SIZE - 4))
+    {
+        status |= UART_STATUS_RX_FULL;
+    }
+
+    return status;
 }
 
 static void uart_update_irq(la64_uart_t *u)
 {    
-    int level = ((u->control & UART_CTRL_RX_IRQ_EN) && (u->status & UART_STATUS_RX_READY)) || ((u->control & UART_CTRL_TX_IRQ_EN) && (u->status & UART_STATUS_TX_EMPTY));
+    int level = ((u->control & UART_CTRL_RX_IRQ_EN) && uart_rx_level(u) >= u->rx_trigger) || (u->control & UART_CTRL_TX_IRQ_EN);
 
     /* updating interrupt */
     if(level)
@@ -65,70 +106,229 @@ static void uart_update_irq(la64_uart_t *u)
     }
 }
 
-static void *uart_input_thread(void *arg)
+static void uart_rx_irq(la64_uart_t *u)
 {
-    la64_uart_t *u = (la64_uart_t *)arg;
+    /* one interrupt per batch, the next one waits until the guest read something */
+    if((u->control & UART_CTRL_RX_IRQ_EN) &&
+       !atomic_exchange(&u->rx_irq_sent, true))
+    {
+        la64_raise_interrupt(u->machine, LA64_IRQ_UART);
+    }
+}
+
+static void uart_rx_ready(void *ctx);
+
+static void uart_disconnect(la64_uart_t *u)
+{
+    /* socket clients come and go, the listener stays */
+    la64_ioloop_remove(u->machine->ioloop, u->rx_source);
+    u->rx_source = NULL;
+
+    int fd = atomic_exchange(&u->rx_fd, -1);
+    atomic_store(&u->tx_fd, -1);
+
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+static void uart_accept(void *ctx)
+{
+    la64_uart_t *u = (la64_uart_t *)ctx;
+
+    int client = accept(u->listen_fd, NULL, NULL);
+
+    if(client < 0)
+    {
+        return;
+    }
+
+    /* one client at a time, like a real serial line */
+    if(u->rx_source != NULL)
+    {
+        close(client);
+        return;
+    }
+
+    /* a stalled client drops output instead of blocking the writer */
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+
+    atomic_store(&u->tx_fd, client);
+    atomic_store(&u->rx_fd, client);
+    u->rx_source = la64_ioloop_add_fd(u->machine->ioloop, client, uart_rx_ready, u);
+}
+
+static void uart_rx_idle(void *ctx)
+{
+    la64_uart_t *u = (la64_uart_t *)ctx;
+
+    /* the line went quiet with bytes still below the trigger */
+    if(uart_rx_level(u) != 0)
+    {
+        uart_rx_irq(u);
+    }
+}
+
+static void uart_rx_ready(void *ctx)
+{
+    la64_uart_t *u = (la64_uart_t *)ctx;
 
-    uint8_t ch;
+    uint8_t chunk[256];
     
-    while(atomic_load(&u->running)) 
-    {
-        fd_set fds;
-        struct timeval tv;
-        
-        FD_ZERO(&fds);
-        FD_SET(STDIN_FILENO, &fds);
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000;
-        
-        int ready = select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv);
-        
-        if(ready <= 0)
+    ssize_t n = read(atomic_load(&u->rx_fd), chunk, sizeof(chunk));
+
+    if(n <= 0)
+    {
+        /* nothing will ever come from this side again */
+        if(n == 0)
         {
-            continue;
+            if(u->backend == LA64_UART_BACKEND_SOCKET)
+            {
+                uart_disconnect(u);
+            }
+            else
+            {
+                la64_ioloop_remove(u->machine->ioloop, u->rx_source);
+                u->rx_source = NULL;
+            }
         }
-        
-        ssize_t n = read(STDIN_FILENO, &ch, 1);
+        return;
+    }
 
-        if(n <= 0)
+    uint32_t head = atomic_load(&u->rx_head);
+    uint32_t tail = atomic_load(&u->rx_tail);
+
+    for(ssize_t i = 0; i < n; i++)
+    {
+        if(chunk[i] == 0x03 &&
+           u->backend == LA64_UART_BACKEND_STDIO)
         {
-            continue;
+            la64_ioloop_remove(u->machine->ioloop, u->rx_source);
+            u->rx_source = NULL;
+            break;
         }
 
-        if(ch == 0x03)
+        if(tail - head >= UART_BUF_SIZE)
         {
-            atomic_store(&u->running, false);
+            atomic_fetch_or(&u->status, UART_STATUS_OVERFLOW);
             break;
         }
-        
-        pthread_mutex_lock(&u->mutex);
-        
-        uint32_t next = (u->rx_tail + 1) % UART_BUF_SIZE;
 
-        if(next == u->rx_head)
+        u->rx_buf[tail & (UART_BUF_SIZE - 1)] = chunk[i];
+        tail++;
+    }
+
+    /* publishing the whole chunk at once */
+    atomic_store(&u->rx_tail, tail);
+
+    if(uart_rx_level(u) >= u->rx_trigger)
+    {
+        uart_rx_irq(u);
+    }
+
+    /* every chunk restarts the idle timeout */
+    if(u->rx_timeout != 0)
+    {
+        la64_ioloop_arm_timer(u->machine->ioloop, u->idle_timer, (uint64_t)u->rx_timeout * 1000ULL, 0);
+    }
+}
+
+static void *uart_output_thread(void *arg)
+{
+    la64_uart_t *u = (la64_uart_t *)arg;
+
+    while(1)
+    {
+        uint32_t head = atomic_load(&u->tx_head);
+        uint32_t tail = atomic_load(&u->tx_tail);
+
+        if(head == tail)
         {
-            u->status |= UART_STATUS_OVERFLOW;
+            /* only leaving once everything queued made it out */
+            if(!atomic_load(&u->tx_running))
+            {
+                break;
+            }
+
+            pthread_mutex_lock(&u->tx_mutex);
+            atomic_store(&u->tx_waiting, true);
+
+            if(atomic_load(&u->tx_tail) == head &&
+               atomic_load(&u->tx_running))
+            {
+                pthread_cond_wait(&u->tx_cond, &u->tx_mutex);
+            }
+
+            atomic_store(&u->tx_waiting, false);
+            pthread_mutex_unlock(&u->tx_mutex);
+            continue;
         }
-        else
+
+        /* the pending bytes wrap around the end at most once */
+        uint32_t idx = head & (UART_TX_BUF_SIZE - 1);
+        uint32_t len = tail - head;
+        uint32_t first = (len < UART_TX_BUF_SIZE - idx) ? len : UART_TX_BUF_SIZE - idx;
+
+        struct iovec iov[2] = {
+            { .iov_base = &u->tx_buf[idx], .iov_len = first },
+            { .iov_base = u->tx_buf, .iov_len = len - first },
+        };
+
+        int fd = atomic_load(&u->tx_fd);
+        ssize_t n = len;
+
+        if(fd >= 0)
         {
-            u->rx_buf[u->rx_tail] = ch;
-            u->rx_tail = next;
-            u->status |= UART_STATUS_RX_READY;
-            
-            if(((u->rx_tail - u->rx_head) % UART_BUF_SIZE) > (UART_BUF_SIZE - 4))
+            n = writev(fd, iov, (len > first) ? 2 : 1);
+
+            if(n < 0 &&
+               errno == EINTR)
             {
-                u->status |= UART_STATUS_RX_FULL;
+                continue;
+            }
+
+            /* a host side that went away drops the output, like an unplugged cable */
+            if(n <= 0)
+            {
+                n = len;
             }
-            
-            uart_update_irq(u);
         }
-        
-        pthread_mutex_unlock(&u->mutex);
+
+        atomic_store(&u->tx_head, head + (uint32_t)n);
     }
-    
+
     return NULL;
 }
 
+static void uart_transmit(la64_uart_t *u,
+                          uint8_t ch)
+{
+    uint32_t tail = atomic_load(&u->tx_tail);
+
+    /* a full ring stalls the guest until the writer caught up, or someone stops the core */
+    while(tail - atomic_load(&u->tx_head) >= UART_TX_BUF_SIZE)
+    {
+        if(atomic_load_explicit(&u->machine->core->stop, memory_order_relaxed))
+        {
+            return;
+        }
+
+        sched_yield();
+    }
+
+    u->tx_buf[tail & (UART_TX_BUF_SIZE - 1)] = ch;
+    atomic_store(&u->tx_tail, tail + 1);
+
+    /* the writer only needs a wakeup when it went to sleep */
+    if(atomic_load(&u->tx_waiting))
+    {
+        pthread_mutex_lock(&u->tx_mutex);
+        pthread_cond_signal(&u->tx_cond);
+        pthread_mutex_unlock(&u->tx_mutex);
+    }
+}
+
 static inline void la64_uart_start(la64_uart_t *u)
 {
     if(u->running)
@@ -137,8 +337,28 @@ static inline void la64_uart_start(la64_uart_t *u)
     }
     
     atomic_store(&u->running, true);
-    uart_set_raw_mode();
-    pthread_create(&u->thread, NULL, uart_input_thread, u);
+
+    if(u->backend == LA64_UART_BACKEND_STDIO)
+    {
+        uart_set_raw_mode(u);
+    }
+
+    int rx_fd = atomic_load(&u->rx_fd);
+
+    if(rx_fd >= 0)
+    {
+        u->rx_source = la64_ioloop_add_fd(u->machine->ioloop, rx_fd, uart_rx_ready, u);
+
+        if(u->rx_source == NULL)
+        {
+            fprintf(stderr, "[uart] cannot watch input fd %d, console input is off\n", rx_fd);
+        }
+    }
+
+    if(u->listen_fd >= 0)
+    {
+        u->listen_source = la64_ioloop_add_fd(u->machine->ioloop, u->listen_fd, uart_accept, u);
+    }
 }
 
 static inline void la64_uart_stop(la64_uart_t *u)
@@ -149,14 +369,158 @@ static inline void la64_uart_stop(la64_uart_t *u)
     }
     
     atomic_store(&u->running, false);
-    pthread_join(u->thread, NULL);
-    uart_restore_mode();
+
+    /* holding the loop so no callback is halfway through */
+    la64_ioloop_lock(u->machine->ioloop);
+    la64_ioloop_remove(u->machine->ioloop, u->rx_source);
+    la64_ioloop_remove(u->machine->ioloop, u->listen_source);
+    u->rx_source = NULL;
+    u->listen_source = NULL;
+    la64_ioloop_unlock(u->machine->ioloop);
+
+    if(u->backend == LA64_UART_BACKEND_STDIO)
+    {
+        uart_restore_mode(u);
+    }
+}
+
+static void la64_uart_close_backend(la64_uart_t *u)
+{
+    int rx_fd = atomic_exchange(&u->rx_fd, -1);
+    int tx_fd = atomic_exchange(&u->tx_fd, -1);
+
+    /* standard streams belong to the process */
+    if(rx_fd > STDERR_FILENO)
+    {
+        close(rx_fd);
+    }
+
+    if(tx_fd > STDERR_FILENO &&
+       tx_fd != rx_fd)
+    {
+        close(tx_fd);
+    }
+
+    if(u->listen_fd >= 0)
+    {
+        close(u->listen_fd);
+        u->listen_fd = -1;
+    }
+}
+
+bool la64_uart_attach(la64_uart_t *u,
+                      const char *spec)
+{
+    int backend;
+    int rx_fd = -1;
+    int tx_fd = -1;
+    int listen_fd = -1;
+
+    if(strcmp(spec, "stdio") == 0)
+    {
+        backend = LA64_UART_BACKEND_STDIO;
+        rx_fd = STDIN_FILENO;
+        tx_fd = STDOUT_FILENO;
+    }
+    else if(strcmp(spec, "null") == 0)
+    {
+        backend = LA64_UART_BACKEND_NULL;
+    }
+    else if(strcmp(spec, "pty") == 0)
+    {
+        backend = LA64_UART_BACKEND_PTY;
+        rx_fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+        if(rx_fd < 0 ||
+           grantpt(rx_fd) != 0 ||
+           unlockpt(rx_fd) != 0)
+        {
+            fprintf(stderr, "[uart] failed to allocate pty\n");
+            goto out_close;
+        }
+
+        /* nobody on the slave side yet must not block the writer */
+        fcntl(rx_fd, F_SETFL, fcntl(rx_fd, F_GETFL) | O_NONBLOCK);
+
+        tx_fd = rx_fd;
+        fprintf(stderr, "[uart] attached to %s\n", ptsname(rx_fd));
+    }
+    else if(strncmp(spec, "unix:", 5) == 0)
+    {
+        backend = LA64_UART_BACKEND_SOCKET;
+
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+        if(strlen(spec + 5) >= sizeof(addr.sun_path))
+        {
+            fprintf(stderr, "[uart] socket path %s is too long\n", spec + 5);
+            return false;
+        }
+
+        strcpy(addr.sun_path, spec + 5);
+        unlink(addr.sun_path);
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if(listen_fd < 0 ||
+           bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+           listen(listen_fd, 1) != 0)
+        {
+            fprintf(stderr, "[uart] failed to listen on %s\n", addr.sun_path);
+            goto out_close;
+        }
+
+        /* clients hanging up must not take the vm down with them */
+        signal(SIGPIPE, SIG_IGN);
+    }
+    else if(strncmp(spec, "file:", 5) == 0)
+    {
+        backend = LA64_UART_BACKEND_FILE;
+        tx_fd = open(spec + 5, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if(tx_fd < 0)
+        {
+            fprintf(stderr, "[uart] failed to open %s\n", spec + 5);
+            return false;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "[uart] unknown backend %s\n", spec);
+        return false;
+    }
+
+    /* swapping the backend underneath a stopped input thread */
+    la64_uart_stop(u);
+    la64_uart_close_backend(u);
+
+    u->backend = backend;
+    u->listen_fd = listen_fd;
+    atomic_store(&u->tx_fd, tx_fd);
+    atomic_store(&u->rx_fd, rx_fd);
+
+    la64_uart_start(u);
+
+    return true;
+
+out_close:
+    if(rx_fd >= 0)
+    {
+        close(rx_fd);
+    }
+
+    if(listen_fd >= 0)
+    {
+        close(listen_fd);
+    }
+
+    return false;
 }
 
 la64_uart_t *la64_uart_alloc(la64_machine_t *machine)
 {
     /* allocate uart */
-    la64_uart_t *u = malloc(sizeof(la64_uart_t));
+    la64_uart_t *u = calloc(1, sizeof(la64_uart_t));
 
     /* null pointer check */
     if(u == NULL)
@@ -173,12 +537,28 @@ la64_uart_t *la64_uart_alloc(la64_machine_t *machine)
 
     /* setting up uart */
     u->machine = machine;
-    u->status = UART_STATUS_TX_EMPTY;
+    u->rx_trigger = 1;
     
-    pthread_mutex_init(&u->mutex, NULL);
     atomic_store(&u->running, false);
 
-    la64_uart_start(u);
+    /* disconnected until la64_uart_attach picks a backend */
+    u->backend = LA64_UART_BACKEND_NULL;
+    u->listen_fd = -1;
+    atomic_store(&u->rx_fd, -1);
+    atomic_store(&u->tx_fd, -1);
+
+    u->idle_timer = la64_ioloop_add_timer(machine->ioloop, uart_rx_idle, u);
+
+    if(u->idle_timer == NULL)
+    {
+        free(u);
+        return NULL;
+    }
+
+    pthread_mutex_init(&u->tx_mutex, NULL);
+    pthread_cond_init(&u->tx_cond, NULL);
+    atomic_store(&u->tx_running, true);
+    pthread_create(&u->tx_thread, NULL, uart_output_thread, u);
 
     return u;
 }
@@ -186,45 +566,71 @@ la64_uart_t *la64_uart_alloc(la64_machine_t *machine)
 void la64_uart_dealloc(la64_uart_t *u)
 {
     la64_uart_stop(u);
-    pthread_mutex_destroy(&u->mutex);
+    la64_ioloop_remove(u->machine->ioloop, u->idle_timer);
+
+    /* letting the writer flush what the guest queued */
+    pthread_mutex_lock(&u->tx_mutex);
+    atomic_store(&u->tx_running, false);
+    pthread_cond_signal(&u->tx_cond);
+    pthread_mutex_unlock(&u->tx_mutex);
+    pthread_join(u->tx_thread, NULL);
+
+    la64_uart_close_backend(u);
+
+    pthread_cond_destroy(&u->tx_cond);
+    pthread_mutex_destroy(&u->tx_mutex);
     free(u);
 }
-
 uint64_t la64_uart_read(la64_core_t *core, void *device, uint64_t offset, int size)
 {
     /* getting uart */
     la64_uart_t *u = (la64_uart_t *)device;
 
-    pthread_mutex_lock(&u->mutex);
     uint64_t result = 0;
 
     /* perform read */
     switch(offset)
     {
         case UART_REG_DATA:
-            if(u->rx_head != u->rx_tail)
+        {
+            uint32_t head = atomic_load(&u->rx_head);
+
+            if(head != atomic_load(&u->rx_tail))
             {
-                result = u->rx_buf[u->rx_head];
-                u->rx_head = (u->rx_head + 1) % UART_BUF_SIZE;
-                if(u->rx_head == u->rx_tail)
+                result = u->rx_buf[head & (UART_BUF_SIZE - 1)];
+                atomic_store(&u->rx_head, head + 1);
+
+                /* the guest is draining, the next batch may interrupt again */
+                atomic_store(&u->rx_irq_sent, false);
+
+                /* nothing left to serve, dropping a still pending interrupt */
+                if(uart_rx_level(u) == 0 &&
+                   !(u->control & UART_CTRL_TX_IRQ_EN))
                 {
-                    u->status &= ~UART_STATUS_RX_READY;
+                    la64_clear_interrupt(u->machine, LA64_IRQ_UART);
                 }
-                u->status &= ~UART_STATUS_RX_FULL;
-                uart_update_irq(u);
             }
             break;
+        }
         case UART_REG_STATUS:
-            result = u->status;
+            result = uart_status(u);
             break;
         case UART_REG_CONTROL:
             result = u->control;
             break;
+        case UART_REG_RX_TRIGGER:
+            result = u->rx_trigger;
+            break;
+        case UART_REG_RX_TIMEOUT:
+            result = u->rx_timeout;
+            break;
+        case UART_REG_RX_LEVEL:
+            result = uart_rx_level(u);
+            break;
         default:
             break;
     }
 
-    pthread_mutex_unlock(&u->mutex);
     return result;
 }
 
@@ -233,30 +639,39 @@ void la64_uart_write(la64_core_t *core, void *device, uint64_t offset, uint64_t
     /* getting uart */
     la64_uart_t *u = (la64_uart_t *)device;
 
-    pthread_mutex_lock(&u->mutex);
-
     /* perform write */
     switch(offset)
     {
         case UART_REG_DATA:
-            putchar((char)(value & 0xFF));
-            fflush(stdout);
-            u->status |= UART_STATUS_TX_EMPTY;
+            uart_transmit(u, (uint8_t)(value & 0xFF));
             uart_update_irq(u);
             break;
         case UART_REG_CONTROL:
             u->control = (uint32_t)value;
             if(value & UART_CTRL_RESET)
             {
-                u->rx_head = u->rx_tail = 0;
-                u->status = UART_STATUS_TX_EMPTY;
+                atomic_store(&u->rx_head, atomic_load(&u->rx_tail));
+                atomic_store(&u->status, 0);
                 u->control &= ~UART_CTRL_RESET;
             }
             uart_update_irq(u);
             break;
+        case UART_REG_RX_TRIGGER:
+            /* clamped so the trigger stays reachable */
+            if(value < 1)
+            {
+                value = 1;
+            }
+            else if(value > UART_BUF_SIZE)
+            {
+                value = UART_BUF_SIZE;
+            }
+            u->rx_trigger = (uint32_t)value;
+            break;
+        case UART_REG_RX_TIMEOUT:
+            u->rx_timeout = (uint32_t)value;
+            break;
         default:
             break;
     }
-
-    pthread_mutex_unlock(&u->mutex);
 }
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <la64vm/forkserver.h>
+#include <la64vm/machine.h>
+
+static int forkserver_clone(la64_forkserver_t *server,
+                            uint64_t clone_id)
+{
+    la64_machine_t *machine = la64_machine_alloc(server->memory_size);
+
+    if(machine == NULL)
+    {
+        fprintf(stderr, "[fork] failed to allocate clone %llu\n", (unsigned long long)clone_id);
+        return 1;
+    }
+
+    /* the same configuration the server was started with */
+    if(!la64_memory_clone(machine->memory, server->ram_fd) ||
+       !la64_uart_attach(machine->uart, "stdio") ||
+       (server->disk_path != NULL && !la64_disk_attach(machine->disk, server->disk_path)))
+    {
+        la64_machine_dealloc(machine);
+        return 1;
+    }
+
+    machine->balloon->ctrl = server->balloon_ctrl;
+    machine->balloon->target = server->balloon_target;
+
+    /* guest time never goes backwards across the ready store */
+    la64_timepage_rebase(machine->timepage, server->boot_cycles);
+    la64_timer_restore(machine->timer, server->timer_channels);
+
+#if defined(__linux__) || defined(__APPLE__)
+    machine->display->headless = true;
+#endif /* __linux__ || __APPLE__ */
+
+    machine->clone_id = clone_id;
+
+    /* resuming where the original stopped, on a core of its own */
+    la64_core_t *core = machine->core;
+    memcpy(core, &(server->core), sizeof(la64_core_t));
+    core->pthread = 0;
+    core->machine = machine;
+    atomic_store(&core->stop, false);
+
+    la64_core_execute(core);
+
+    int status = (int)(machine->exit_code & 0xFF);
+
+    la64_machine_dealloc(machine);
+
+    return status;
+}
+
+la64_forkserver_t *la64_forkserver_alloc(la64_machine_t *machine,
+                                         const char *socket_path,
+                                         const char *disk_path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if(strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "[fork] socket path %s is too long\n", socket_path);
+        return NULL;
+    }
+
+    /* the ram has to be shareable from before the image was loaded */
+    if(machine->memory->fd < 0)
+    {
+        return NULL;
+    }
+
+    la64_forkserver_t *server = calloc(1, sizeof(la64_forkserver_t));
+
+    if(server == NULL)
+    {
+        return NULL;
+    }
+
+    server->socket_path = strdup(socket_path);
+    server->disk_path = (disk_path != NULL) ? strdup(disk_path) : NULL;
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    strcpy(addr.sun_path, socket_path);
+    unlink(addr.sun_path);
+
+    if(server->socket_path == NULL ||
+       (disk_path != NULL && server->disk_path == NULL) ||
+       server->listen_fd < 0 ||
+       bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+       listen(server->listen_fd, 64) != 0)
+    {
+        fprintf(stderr, "[fork] failed to listen on %s\n", socket_path);
+
+        if(server->listen_fd >= 0)
+        {
+            close(server->listen_fd);
+        }
+
+        free(server->disk_path);
+        free(server->socket_path);
+        free(server);
+        return NULL;
+    }
+
+    /* taking the ram over, it outlives the machine it came from */
+    server->ram_fd = machine->memory->fd;
+    server->memory_size = machine->memory->memory_size;
+    machine->memory->fd = -1;
+
+    memcpy(&(server->core), machine->core, sizeof(la64_core_t));
+
+    server->boot_cycles = machine->timepage->boot_cycles;
+    la64_timer_save(machine->timer, server->timer_channels);
+
+    server->balloon_ctrl = machine->balloon->ctrl;
+    server->balloon_target = machine->balloon->target;
+
+    return server;
+}
+
+void la64_forkserver_dealloc(la64_forkserver_t *server)
+{
+    close(server->listen_fd);
+    unlink(server->socket_path);
+    close(server->ram_fd);
+    free(server->disk_path);
+    free(server->socket_path);
+    free(server);
+}
+
+void la64_forkserver_run(la64_forkserver_t *server)
+{
+    /* clones are never waited for, the kernel reaps them */
+    signal(SIGCHLD, SIG_IGN);
+
+    /* clients hanging up must not take the server down with them */
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "[fork] ready, cloning on %s\n", server->socket_path);
+
+    while(1)
+    {
+        int conn = accept(server->listen_fd, NULL, NULL);
+
+        if(conn < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        uint64_t clone_id = ++server->clone_cnt;
+        pid_t pid = fork();
+
+        if(pid == 0)
+        {
+            /* the connection is the clones terminal */
+            close(server->listen_fd);
+            dup2(conn, STDIN_FILENO);
+            dup2(conn, STDOUT_FILENO);
+            close(conn);
+
+            exit(forkserver_clone(server, clone_id));
+        }
+
+        if(pid < 0)
+        {
+            fprintf(stderr, "[fork] failed to fork clone %llu\n", (unsigned long long)clone_id);
+        }
+
+        close(conn);
+    }
+}
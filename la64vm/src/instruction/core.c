@@ -24,6 +24,7 @@
 
 #include <la64vm/instruction/instruction.h>
 #include <la64vm/instruction/core.h>
+#include <la64vm/mmu.h>
 
 void la64_op_hlt(la64_core_t *core)
 {
@@ -43,4 +44,29 @@ void la64_op_nop(la64_core_t *core)
 {
     la64_instr_termcond(core->op.param_cnt != 0);
     /* doing nothing */
-}
\ No newline at end of file
+}
+
+void la64_op_tlbi(la64_core_t *core)
+{
+    la64_instr_termcond(core->op.param_cnt > 2);
+
+    if(core->rl[LA64_REGISTER_CR0] < LA64_ELEVATION_KERNEL)
+    {
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_PERMISSION;
+        return;
+    }
+
+    /* no operand flushes everything, an asid its own entries, an address only that page */
+    switch(core->op.param_cnt)
+    {
+        case 0:
+            la64_mmu_invalidate_all(core);
+            break;
+        case 1:
+            la64_mmu_invalidate_asid(core, *(core->op.param[0]) & LA64_MMU_ASID_MASK);
+            break;
+        case 2:
+            la64_mmu_invalidate_addr(core, *(core->op.param[0]) & LA64_MMU_ASID_MASK, *(core->op.param[1]));
+            break;
+    }
+}
@@ -31,6 +31,7 @@
 void la64_op_b(la64_core_t *core)
 {
     la64_instr_termcond(core->op.param_cnt != 1);
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_BRANCHES);
     core->op.ilen = 0;
     core->rl[LA64_REGISTER_PC] = *(core->op.param[0]);
 }
@@ -111,6 +112,7 @@ void la64_op_bz(la64_core_t *core)
     
     if(*(core->op.param[0]) == 0)
     {
+        la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_BRANCHES);
         core->op.ilen = 0;
         core->rl[LA64_REGISTER_PC] = *(core->op.param[1]);
     }
@@ -122,6 +124,7 @@ void la64_op_bnz(la64_core_t *core)
     
     if(*(core->op.param[0]) != 0)
     {
+        la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_BRANCHES);
         core->op.ilen = 0;
         core->rl[LA64_REGISTER_PC] = *(core->op.param[1]);
     }
@@ -182,6 +185,12 @@ void la64_op_bl(la64_core_t *core)
     la64_push(core, core->rl[LA64_REGISTER_R10]);
     la64_push(core, core->rl[LA64_REGISTER_R11]);
 
+    /* a faulting push leaves the registers alone so the call can be restarted */
+    if(core->page_fault)
+    {
+        return;
+    }
+
     /* writing parameters */
     for(uint8_t i = 1; i < core->op.param_cnt && i < (LA64_REGISTER_R11 - 1); i++)
     {
@@ -195,6 +204,7 @@ void la64_op_bl(la64_core_t *core)
     core->op.ilen = 0;
 
     /* jump! */
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_BRANCHES);
     core->rl[LA64_REGISTER_PC] = param_imm[0];
 }
 
@@ -220,6 +230,8 @@ void la64_op_ret(la64_core_t *core)
     core->rl[LA64_REGISTER_FP] = la64_pop(core);
     core->rl[LA64_REGISTER_PC] = la64_pop(core);
     core->op.ilen = 0;
+
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_BRANCHES);
 }
 
 void la64_op_iret(la64_core_t *core)
@@ -232,30 +244,104 @@ void la64_op_iret(la64_core_t *core)
         return;
     }
 
-    core->rl[LA64_REGISTER_SP] = core->rl[LA64_REGISTER_FP];
+    la64_intc_t *intc = core->machine->intc;
 
-    core->rl[LA64_REGISTER_R11] = la64_pop(core);
-    core->rl[LA64_REGISTER_R10] = la64_pop(core);
-    core->rl[LA64_REGISTER_R9] = la64_pop(core);
-    core->rl[LA64_REGISTER_R8] = la64_pop(core);
-    core->rl[LA64_REGISTER_R7] = la64_pop(core);
-    core->rl[LA64_REGISTER_R6] = la64_pop(core);
-    core->rl[LA64_REGISTER_R5] = la64_pop(core);
-    core->rl[LA64_REGISTER_R4] = la64_pop(core);
-    core->rl[LA64_REGISTER_R3] = la64_pop(core);
-    core->rl[LA64_REGISTER_R2] = la64_pop(core);
-    core->rl[LA64_REGISTER_R1] = la64_pop(core);
-    core->rl[LA64_REGISTER_R0] = la64_pop(core);
-    core->rl[LA64_REGISTER_CF] = la64_pop(core);
-    core->rl[LA64_REGISTER_FP] = la64_pop(core);
-    uint64_t oldsp = la64_pop(core);
-    core->rl[LA64_REGISTER_PC] = la64_pop(core);
-    core->rl[LA64_REGISTER_CR0] = la64_pop(core);
-    core->op.ilen = 0;
+    if(intc->depth > 0 &&
+       intc->active[intc->depth - 1].banked)
+    {
+        /* the handler keeps its registers in the shadow bank for next time */
+        la64_swap_bank(core);
+    }
+    else
+    {
+        core->rl[LA64_REGISTER_SP] = core->rl[LA64_REGISTER_FP];
+
+        core->rl[LA64_REGISTER_R11] = la64_pop(core);
+        core->rl[LA64_REGISTER_R10] = la64_pop(core);
+        core->rl[LA64_REGISTER_R9] = la64_pop(core);
+        core->rl[LA64_REGISTER_R8] = la64_pop(core);
+        core->rl[LA64_REGISTER_R7] = la64_pop(core);
+        core->rl[LA64_REGISTER_R6] = la64_pop(core);
+        core->rl[LA64_REGISTER_R5] = la64_pop(core);
+        core->rl[LA64_REGISTER_R4] = la64_pop(core);
+        core->rl[LA64_REGISTER_R3] = la64_pop(core);
+        core->rl[LA64_REGISTER_R2] = la64_pop(core);
+        core->rl[LA64_REGISTER_R1] = la64_pop(core);
+        core->rl[LA64_REGISTER_R0] = la64_pop(core);
+        core->rl[LA64_REGISTER_CF] = la64_pop(core);
+        core->rl[LA64_REGISTER_FP] = la64_pop(core);
+        uint64_t oldsp = la64_pop(core);
+        core->rl[LA64_REGISTER_PC] = la64_pop(core);
+        core->rl[LA64_REGISTER_CR0] = la64_pop(core);
+
+        core->rl[LA64_REGISTER_SP] = oldsp;
+    }
 
-    core->rl[LA64_REGISTER_SP] = oldsp;
+    core->op.ilen = 0;
 
-    core->machine->intc->current_irq = -1;
-    core->in_interrupt = false;
+    /* an outer handler that got preempted carries on */
+    core->in_interrupt = la64_intc_complete(intc);
     core->halted = false;
 }
+
+void la64_swap_bank(la64_core_t *core)
+{
+    for(int i = 0; i <= LA64_REGISTER_CR0; i++)
+    {
+        uint64_t value = core->rl[i];
+        core->rl[i] = core->shadow[i];
+        core->shadow[i] = value;
+    }
+}
+
+static bool la64_bank_index(la64_core_t *core, uint64_t *param, int *index)
+{
+    /* the bank register is named by the register operand it self */
+    if(param < core->rl ||
+       param > &(core->rl[LA64_REGISTER_CR0]))
+    {
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_BAD_INSTRUCTION;
+        return false;
+    }
+
+    *index = (int)(param - core->rl);
+    return true;
+}
+
+void la64_op_mfb(la64_core_t *core)
+{
+    la64_instr_termcond(core->op.param_cnt != 2);
+
+    if(core->rl[LA64_REGISTER_CR0] < LA64_ELEVATION_KERNEL)
+    {
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_PERMISSION;
+        return;
+    }
+
+    int index;
+    if(!la64_bank_index(core, core->op.param[1], &index))
+    {
+        return;
+    }
+
+    *(core->op.param[0]) = core->shadow[index];
+}
+
+void la64_op_mtb(la64_core_t *core)
+{
+    la64_instr_termcond(core->op.param_cnt != 2);
+
+    if(core->rl[LA64_REGISTER_CR0] < LA64_ELEVATION_KERNEL)
+    {
+        core->rl[LA64_REGISTER_CR2] = LA64_EXCEPTION_PERMISSION;
+        return;
+    }
+
+    int index;
+    if(!la64_bank_index(core, core->op.param[0], &index))
+    {
+        return;
+    }
+
+    core->shadow[index] = *(core->op.param[1]);
+}
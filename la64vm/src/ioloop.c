@@ -0,0 +1,597 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <la64vm/ioloop.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif /* __linux__ */
+
+/* the process wide loop */
+static pthread_mutex_t ioloop_global_mutex = PTHREAD_MUTEX_INITIALIZER;
+static la64_ioloop_t *ioloop_global = NULL;
+
+#if !defined(__linux__)
+static uint64_t ioloop_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif /* !__linux__ */
+
+static void ioloop_source_free(la64_ioloop_source_t *source)
+{
+    /* plain fds belong to whoever registered them */
+    if(source->kind != LA64_IOLOOP_SOURCE_FD &&
+       source->fd >= 0)
+    {
+        close(source->fd);
+    }
+
+#if !defined(__linux__)
+    if(source->kind == LA64_IOLOOP_SOURCE_EVENT)
+    {
+        close(source->wfd);
+    }
+#endif /* !__linux__ */
+
+    free(source);
+}
+
+static void ioloop_bury(la64_ioloop_t *loop)
+{
+    while(loop->graveyard != NULL)
+    {
+        la64_ioloop_source_t *source = loop->graveyard;
+        loop->graveyard = source->next;
+        ioloop_source_free(source);
+    }
+}
+
+static void ioloop_dispatch(la64_ioloop_source_t *source)
+{
+    /* removed while we were waiting */
+    if(source->dead)
+    {
+        return;
+    }
+
+    /* consuming the expiration count or the event counter */
+    if(source->kind != LA64_IOLOOP_SOURCE_FD)
+    {
+#if defined(__linux__)
+        uint64_t cnt;
+        ssize_t n = read(source->fd, &cnt, sizeof(cnt));
+        (void)n;
+#else
+        char buf[64];
+        while(read(source->fd, buf, sizeof(buf)) > 0);
+#endif /* __linux__ */
+    }
+
+    if(source->fn != NULL)
+    {
+        source->fn(source->ctx);
+    }
+}
+
+#if defined(__linux__)
+static void *ioloop_thread(void *arg)
+{
+    la64_ioloop_t *loop = (la64_ioloop_t *)arg;
+
+    struct epoll_event events[LA64_IOLOOP_MAX_EVENTS];
+
+    while(atomic_load(&loop->running))
+    {
+        /* sources epoll refuses are always ready, so only peek while there are any */
+        int n = epoll_wait(loop->epfd, events, LA64_IOLOOP_MAX_EVENTS, atomic_load(&loop->always_ready_cnt) ? 0 : -1);
+
+        pthread_mutex_lock(&loop->mutex);
+
+        for(int i = 0; i < n; i++)
+        {
+            ioloop_dispatch((la64_ioloop_source_t *)events[i].data.ptr);
+        }
+
+        for(la64_ioloop_source_t *s = loop->sources, *next; s != NULL; s = next)
+        {
+            next = s->next;
+
+            if(s->always_ready)
+            {
+                ioloop_dispatch(s);
+            }
+        }
+
+        ioloop_bury(loop);
+
+        pthread_mutex_unlock(&loop->mutex);
+    }
+
+    return NULL;
+}
+#else
+static void *ioloop_thread(void *arg)
+{
+    la64_ioloop_t *loop = (la64_ioloop_t *)arg;
+
+    struct pollfd *pfd = NULL;
+    la64_ioloop_source_t **pfd_source = NULL;
+    int pfd_cap = 0;
+
+    while(atomic_load(&loop->running))
+    {
+        pthread_mutex_lock(&loop->mutex);
+
+        /* rebuilding the poll set, sources change rarely and there are few of them */
+        int cnt = 0;
+        uint64_t deadline = UINT64_MAX;
+
+        for(la64_ioloop_source_t *s = loop->sources; s != NULL; s = s->next)
+        {
+            if(s->kind == LA64_IOLOOP_SOURCE_TIMER)
+            {
+                uint64_t d = atomic_load(&s->deadline);
+
+                if(d != 0 && d < deadline)
+                {
+                    deadline = d;
+                }
+                continue;
+            }
+
+            if(cnt == pfd_cap)
+            {
+                pfd_cap = pfd_cap ? pfd_cap * 2 : 16;
+                pfd = realloc(pfd, pfd_cap * sizeof(struct pollfd));
+                pfd_source = realloc(pfd_source, pfd_cap * sizeof(la64_ioloop_source_t *));
+            }
+
+            pfd[cnt].fd = s->fd;
+            pfd[cnt].events = POLLIN;
+            pfd[cnt].revents = 0;
+            pfd_source[cnt++] = s;
+        }
+
+        pthread_mutex_unlock(&loop->mutex);
+
+        int timeout = -1;
+
+        if(deadline != UINT64_MAX)
+        {
+            uint64_t now = ioloop_now_ns();
+            timeout = (deadline > now) ? (int)((deadline - now + 999999) / 1000000) : 0;
+        }
+
+        int n = poll(pfd, cnt, timeout);
+
+        pthread_mutex_lock(&loop->mutex);
+
+        for(int i = 0; i < cnt && n > 0; i++)
+        {
+            if(pfd[i].revents != 0)
+            {
+                ioloop_dispatch(pfd_source[i]);
+            }
+        }
+
+        /* firing whatever timers expired */
+        uint64_t now = ioloop_now_ns();
+
+        la64_ioloop_source_t *next;
+
+        for(la64_ioloop_source_t *s = loop->sources; s != NULL; s = next)
+        {
+            /* callbacks may remove sources, including the next one */
+            next = s->next;
+
+            if(s->dead ||
+               s->kind != LA64_IOLOOP_SOURCE_TIMER)
+            {
+                continue;
+            }
+
+            uint64_t d = atomic_load(&s->deadline);
+            uint64_t interval = atomic_load(&s->interval);
+
+            /* a timer rearmed meanwhile keeps its new deadline */
+            if(d == 0 ||
+               d > now ||
+               !atomic_compare_exchange_strong(&s->deadline, &d, interval ? now + interval : 0))
+            {
+                continue;
+            }
+
+            ioloop_dispatch(s);
+        }
+
+        ioloop_bury(loop);
+
+        pthread_mutex_unlock(&loop->mutex);
+    }
+
+    free(pfd);
+    free(pfd_source);
+
+    return NULL;
+}
+#endif /* __linux__ */
+
+static la64_ioloop_source_t *ioloop_source_add(la64_ioloop_t *loop,
+                                               int kind,
+                                               int fd,
+                                               la64_ioloop_fn fn,
+                                               void *ctx)
+{
+    la64_ioloop_source_t *source = calloc(1, sizeof(la64_ioloop_source_t));
+
+    if(source == NULL)
+    {
+        return NULL;
+    }
+
+    source->kind = kind;
+    source->fd = fd;
+    source->fn = fn;
+    source->ctx = ctx;
+
+    pthread_mutex_lock(&loop->mutex);
+
+#if defined(__linux__)
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = source };
+
+    if(epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+        /* regular files and /dev/null cannot be polled, but never block either */
+        if(errno != EPERM ||
+           kind != LA64_IOLOOP_SOURCE_FD)
+        {
+            pthread_mutex_unlock(&loop->mutex);
+            free(source);
+            return NULL;
+        }
+
+        source->always_ready = true;
+        atomic_fetch_add(&loop->always_ready_cnt, 1);
+    }
+#endif /* __linux__ */
+
+    source->next = loop->sources;
+    loop->sources = source;
+
+    pthread_mutex_unlock(&loop->mutex);
+
+#if defined(__linux__)
+    /* the loop may be sleeping without a timeout */
+    if(source->always_ready)
+    {
+        la64_ioloop_signal(loop->wakeup);
+    }
+#else
+    /* the poll set is rebuilt on the next round */
+    if(loop->wakeup != NULL)
+    {
+        la64_ioloop_signal(loop->wakeup);
+    }
+#endif /* __linux__ */
+
+    return source;
+}
+
+la64_ioloop_source_t *la64_ioloop_add_fd(la64_ioloop_t *loop,
+                                         int fd,
+                                         la64_ioloop_fn fn,
+                                         void *ctx)
+{
+    return ioloop_source_add(loop, LA64_IOLOOP_SOURCE_FD, fd, fn, ctx);
+}
+
+la64_ioloop_source_t *la64_ioloop_add_timer(la64_ioloop_t *loop,
+                                            la64_ioloop_fn fn,
+                                            void *ctx)
+{
+#if defined(__linux__)
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if(fd < 0)
+    {
+        return NULL;
+    }
+
+    la64_ioloop_source_t *source = ioloop_source_add(loop, LA64_IOLOOP_SOURCE_TIMER, fd, fn, ctx);
+
+    if(source == NULL)
+    {
+        close(fd);
+    }
+
+    return source;
+#else
+    return ioloop_source_add(loop, LA64_IOLOOP_SOURCE_TIMER, -1, fn, ctx);
+#endif /* __linux__ */
+}
+
+la64_ioloop_source_t *la64_ioloop_add_event(la64_ioloop_t *loop,
+                                            la64_ioloop_fn fn,
+                                            void *ctx)
+{
+#if defined(__linux__)
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(fd < 0)
+    {
+        return NULL;
+    }
+
+    la64_ioloop_source_t *source = ioloop_source_add(loop, LA64_IOLOOP_SOURCE_EVENT, fd, fn, ctx);
+
+    if(source == NULL)
+    {
+        close(fd);
+    }
+
+    return source;
+#else
+    int fds[2];
+
+    if(pipe(fds) != 0)
+    {
+        return NULL;
+    }
+
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    la64_ioloop_source_t *source = ioloop_source_add(loop, LA64_IOLOOP_SOURCE_EVENT, fds[0], fn, ctx);
+
+    if(source == NULL)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+
+    source->wfd = fds[1];
+
+    return source;
+#endif /* __linux__ */
+}
+
+void la64_ioloop_remove(la64_ioloop_t *loop,
+                        la64_ioloop_source_t *source)
+{
+    /* null pointer check */
+    if(source == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&loop->mutex);
+
+    /* unlinking it, the loop thread frees it once no event can refer to it anymore */
+    for(la64_ioloop_source_t **s = &loop->sources; *s != NULL; s = &(*s)->next)
+    {
+        if(*s == source)
+        {
+            *s = source->next;
+            break;
+        }
+    }
+
+#if defined(__linux__)
+    if(source->always_ready)
+    {
+        atomic_fetch_sub(&loop->always_ready_cnt, 1);
+    }
+    else
+    {
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, source->fd, NULL);
+    }
+#endif /* __linux__ */
+
+    source->dead = true;
+    source->next = loop->graveyard;
+    loop->graveyard = source;
+
+    pthread_mutex_unlock(&loop->mutex);
+
+    la64_ioloop_signal(loop->wakeup);
+}
+
+void la64_ioloop_lock(la64_ioloop_t *loop)
+{
+    pthread_mutex_lock(&loop->mutex);
+}
+
+void la64_ioloop_unlock(la64_ioloop_t *loop)
+{
+    pthread_mutex_unlock(&loop->mutex);
+}
+
+void la64_ioloop_arm_timer(la64_ioloop_t *loop,
+                           la64_ioloop_source_t *timer,
+                           uint64_t first_ns,
+                           uint64_t interval_ns)
+{
+    /* a first expiry of 0 disarms the timer */
+#if defined(__linux__)
+    struct itimerspec its = {
+        .it_value = { .tv_sec = first_ns / 1000000000ULL, .tv_nsec = first_ns % 1000000000ULL },
+        .it_interval = { .tv_sec = interval_ns / 1000000000ULL, .tv_nsec = interval_ns % 1000000000ULL },
+    };
+
+    timerfd_settime(timer->fd, 0, &its, NULL);
+#else
+    /* lock free, devices arm under their own locks which callbacks take with the loop held */
+    atomic_store(&timer->interval, interval_ns);
+    atomic_store(&timer->deadline, first_ns ? ioloop_now_ns() + first_ns : 0);
+
+    la64_ioloop_signal(loop->wakeup);
+#endif /* __linux__ */
+}
+
+void la64_ioloop_signal(la64_ioloop_source_t *event)
+{
+    /* async signal safe, so signal handlers can use it too */
+#if defined(__linux__)
+    uint64_t one = 1;
+    ssize_t n = write(event->fd, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t n = write(event->wfd, &one, sizeof(one));
+#endif /* __linux__ */
+    (void)n;
+}
+
+static la64_ioloop_t *ioloop_alloc(void)
+{
+    la64_ioloop_t *loop = calloc(1, sizeof(la64_ioloop_t));
+
+    if(loop == NULL)
+    {
+        return NULL;
+    }
+
+    /* callbacks rearm timers and remove sources while the loop holds the lock */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&loop->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+#if defined(__linux__)
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    if(loop->epfd < 0)
+    {
+        goto out_free;
+    }
+#endif /* __linux__ */
+
+    loop->wakeup = la64_ioloop_add_event(loop, NULL, NULL);
+
+    if(loop->wakeup == NULL)
+    {
+        goto out_close;
+    }
+
+    atomic_store(&loop->running, true);
+
+    if(pthread_create(&loop->thread, NULL, ioloop_thread, loop) != 0)
+    {
+        ioloop_source_free(loop->wakeup);
+        goto out_close;
+    }
+
+    return loop;
+
+out_close:
+#if defined(__linux__)
+    close(loop->epfd);
+out_free:
+#endif /* __linux__ */
+    pthread_mutex_destroy(&loop->mutex);
+    free(loop);
+    return NULL;
+}
+
+static void ioloop_dealloc(la64_ioloop_t *loop)
+{
+    atomic_store(&loop->running, false);
+    la64_ioloop_signal(loop->wakeup);
+    pthread_join(loop->thread, NULL);
+
+    /* devices should have removed theirs already, the wakeup is always left */
+    ioloop_bury(loop);
+
+    while(loop->sources != NULL)
+    {
+        la64_ioloop_source_t *source = loop->sources;
+        loop->sources = source->next;
+        ioloop_source_free(source);
+    }
+
+#if defined(__linux__)
+    close(loop->epfd);
+#endif /* __linux__ */
+
+    pthread_mutex_destroy(&loop->mutex);
+    free(loop);
+}
+
+la64_ioloop_t *la64_ioloop_acquire(void)
+{
+    pthread_mutex_lock(&ioloop_global_mutex);
+
+    if(ioloop_global == NULL)
+    {
+        ioloop_global = ioloop_alloc();
+    }
+
+    if(ioloop_global != NULL)
+    {
+        ioloop_global->refcnt++;
+    }
+
+    la64_ioloop_t *loop = ioloop_global;
+
+    pthread_mutex_unlock(&ioloop_global_mutex);
+
+    return loop;
+}
+
+void la64_ioloop_release(la64_ioloop_t *loop)
+{
+    /* null pointer check */
+    if(loop == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&ioloop_global_mutex);
+
+    /* the last machine out turns off the lights */
+    if(--loop->refcnt == 0)
+    {
+        ioloop_dealloc(loop);
+        ioloop_global = NULL;
+    }
+
+    pthread_mutex_unlock(&ioloop_global_mutex);
+}
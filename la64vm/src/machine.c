@@ -29,6 +29,8 @@
 #include <la64vm/device/platform.h>
 #include <la64vm/device/mc.h>
 
+#include <lautils/bitwalker.h>
+
 la64_machine_t *la64_machine_alloc(uint64_t memory_size)
 {
     /* allocating brand new machine */
@@ -52,11 +54,18 @@ la64_machine_t *la64_machine_alloc(uint64_t memory_size)
         goto out_release_memory;
     }
 
+    /* host i/o thread the device backends run on */
+    machine->ioloop = la64_ioloop_acquire();
+    if(machine->ioloop == NULL)
+    {
+        goto out_release_mmio;
+    }
+
     /* allocating main core */
     machine->core = la64_core_alloc();
     if(machine->core == NULL)
     {
-        goto out_release_mmio;
+        goto out_release_ioloop;
     }
     machine->core->machine = machine;
 
@@ -79,20 +88,68 @@ la64_machine_t *la64_machine_alloc(uint64_t memory_size)
         goto out_release_timer;
     }
 
+    machine->pmu = la64_pmu_alloc(machine);
+    if(machine->pmu == NULL)
+    {
+        goto out_release_uart;
+    }
+
+    machine->blitter = la64_blitter_alloc(machine);
+    if(machine->blitter == NULL)
+    {
+        goto out_release_pmu;
+    }
+
+    machine->disk = la64_disk_alloc(machine);
+    if(machine->disk == NULL)
+    {
+        goto out_release_blitter;
+    }
+
+    machine->net = la64_net_alloc(machine);
+    if(machine->net == NULL)
+    {
+        goto out_release_disk;
+    }
+
+    machine->dma = la64_dma_alloc(machine);
+    if(machine->dma == NULL)
+    {
+        goto out_release_net;
+    }
+
+    machine->timepage = la64_timepage_alloc(machine);
+    if(machine->timepage == NULL)
+    {
+        goto out_release_dma;
+    }
+
+    machine->shm = la64_shm_alloc(machine);
+    if(machine->shm == NULL)
+    {
+        goto out_release_timepage;
+    }
+
+    machine->balloon = la64_balloon_alloc(machine);
+    if(machine->balloon == NULL)
+    {
+        goto out_release_shm;
+    }
+
     /* register device less(means without allocation) devices */
     if(!la64_mmio_register(machine->mmio_bus, LA64_RTC_BASE, LA64_RTC_SIZE, NULL, la64_rtc_read, NULL))
     {
-        goto out_release_uart;
+        goto out_release_balloon;
     }
 
     if(!la64_mmio_register(machine->mmio_bus, LA64_MC_BASE, LA64_MC_SIZE, NULL, la64_mc_read, NULL))
     {
-        goto out_release_uart;
+        goto out_release_balloon;
     }
 
     if(!la64_mmio_register(machine->mmio_bus, LA64_PLATFORM_BASE, LA64_PLATFORM_SIZE, NULL, la64_platform_read, la64_platform_write))
     {
-        goto out_release_uart;
+        goto out_release_balloon;
     }
 
     /* apple and linux have support for the LA64 LCD display */
@@ -101,7 +158,7 @@ la64_machine_t *la64_machine_alloc(uint64_t memory_size)
 
     if(machine->display == NULL)
     {
-        goto out_release_uart;
+        goto out_release_balloon;
     }
 #endif /* __linux__ */
 
@@ -112,6 +169,22 @@ la64_machine_t *la64_machine_alloc(uint64_t memory_size)
 out_release_display:
     la64_display_dealloc(machine->display);
 #endif /* __linux__ */
+out_release_balloon:
+    la64_balloon_dealloc(machine->balloon);
+out_release_shm:
+    la64_shm_dealloc(machine->shm);
+out_release_timepage:
+    la64_timepage_dealloc(machine->timepage);
+out_release_dma:
+    la64_dma_dealloc(machine->dma);
+out_release_net:
+    la64_net_dealloc(machine->net);
+out_release_disk:
+    la64_disk_dealloc(machine->disk);
+out_release_blitter:
+    la64_blitter_dealloc(machine->blitter);
+out_release_pmu:
+    la64_pmu_dealloc(machine->pmu);
 out_release_uart:
     la64_uart_dealloc(machine->uart);
 out_release_timer:
@@ -120,6 +193,8 @@ out_release_intc:
     la64_intc_dealloc(machine->intc);
 out_release_core:
     la64_core_dealloc(machine->core);
+out_release_ioloop:
+    la64_ioloop_release(machine->ioloop);
 out_release_mmio:
     la64_mmio_dealloc(machine->mmio_bus);
 out_release_memory:
@@ -131,6 +206,12 @@ out_release_machine:
 
 void la64_machine_dealloc(la64_machine_t *machine)
 {
+    /* flushing profile while the core is still around */
+    if(machine->profiler)
+    {
+        la64_profiler_dealloc(machine->profiler);
+    }
+
     /* release devices */
 #if defined(__linux__)  || defined(__APPLE__)
     if(machine->display)
@@ -139,6 +220,46 @@ void la64_machine_dealloc(la64_machine_t *machine)
     }
 #endif /* __linux__ */
 
+    if(machine->balloon)
+    {
+        la64_balloon_dealloc(machine->balloon);
+    }
+
+    if(machine->shm)
+    {
+        la64_shm_dealloc(machine->shm);
+    }
+
+    if(machine->timepage)
+    {
+        la64_timepage_dealloc(machine->timepage);
+    }
+
+    if(machine->dma)
+    {
+        la64_dma_dealloc(machine->dma);
+    }
+
+    if(machine->net)
+    {
+        la64_net_dealloc(machine->net);
+    }
+
+    if(machine->disk)
+    {
+        la64_disk_dealloc(machine->disk);
+    }
+
+    if(machine->blitter)
+    {
+        la64_blitter_dealloc(machine->blitter);
+    }
+
+    if(machine->pmu)
+    {
+        la64_pmu_dealloc(machine->pmu);
+    }
+
     if(machine->uart)
     {
         la64_uart_dealloc(machine->uart);
@@ -157,6 +278,11 @@ void la64_machine_dealloc(la64_machine_t *machine)
     /* releasing machine internals */
     la64_core_dealloc(machine->core);
 
+    if(machine->ioloop)
+    {
+        la64_ioloop_release(machine->ioloop);
+    }
+
     if(machine->mmio_bus)
     {
         la64_mmio_dealloc(machine->mmio_bus);
@@ -167,3 +293,29 @@ void la64_machine_dealloc(la64_machine_t *machine)
     /* release machine it self */
     free(machine);
 }
+
+bool la64_machine_boot(la64_machine_t *machine,
+                       const char *image_path)
+{
+    /* load boot image */
+    if(!la64_memory_load_image(machine->memory, image_path))
+    {
+        return false;
+    }
+
+    /*
+     * getting entry point of boot image of virtual machine
+     * and setting program pointer of first core to it
+     */
+    bitwalker_t bw;
+    bitwalker_init_read(&bw, machine->memory->memory, 8, BW_LITTLE_ENDIAN);
+    machine->core->rl[LA64_REGISTER_PC] = bitwalker_read(&bw, 64);
+
+    /* setting stack pointer of  */
+    machine->core->rl[LA64_REGISTER_SP] = machine->memory->memory_size - 8;
+
+    /* setting elevation to system monitor */
+    machine->core->rl[LA64_REGISTER_CR0] = LA64_ELEVATION_SECURE_MONITOR;
+
+    return true;
+}
@@ -27,21 +27,169 @@
 #include <unistd.h>
 #include <string.h>
 #include <pthread.h>
+#include <signal.h>
 
 #include <la64vm/machine.h>
+#include <la64vm/runner.h>
+#include <la64vm/forkserver.h>
+#include <la64vm/mmu.h>
 #include <la64vm/device/display.h>
 
-#include <lautils/bitwalker.h>
+#if defined(__linux__) || defined(__APPLE__)
+static la64_display_t *dump_display = NULL;
+
+static void dump_signal_handler(int sig)
+{
+    /* only flips an atomic, the dump thread does the rest */
+    la64_display_request_dump(dump_display);
+}
+#endif /* __linux__ || __APPLE__ */
 
 int main(int argc, char *argv[])
 {
+    const char *image_path = NULL;
+    const char *profile_path = NULL;
+    const char *symbol_map_path = NULL;
+    uint64_t profile_hz = LA64_PROFILER_DEFAULT_HZ;
+    bool headless = false;
+    const char *dump_prefix = NULL;
+    uint64_t dump_interval_ms = 0;
+    const char *uart_backend = "stdio";
+    const char *disk_path = NULL;
+    const char *net_backend = NULL;
+    const char *shm_spec = NULL;
+    const char *ram_region[LA64_MEMORY_MAX_REGIONS];
+    int ram_region_cnt = 0;
+    uint64_t balloon_target = 0;
+    bool mergeable = false;
+    const char *job_list_path = NULL;
+    int worker_cnt = 0;
+    uint64_t job_timeout_ms = 0;
+    const char *fork_socket = NULL;
+
     if(argc < 2 || argv == NULL || argv[1] == NULL)
     {
         goto usage;
     }
 
+    /* parse arguments */
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            profile_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            symbol_map_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-F") == 0 && i + 1 < argc)
+        {
+            profile_hz = strtoull(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-H") == 0)
+        {
+            headless = true;
+        }
+        else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            dump_prefix = argv[++i];
+        }
+        else if(strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            dump_interval_ms = strtoull(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+        {
+            uart_backend = argv[++i];
+        }
+        else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            disk_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            net_backend = argv[++i];
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            shm_spec = argv[++i];
+        }
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc && ram_region_cnt < LA64_MEMORY_MAX_REGIONS)
+        {
+            ram_region[ram_region_cnt++] = argv[++i];
+        }
+        else if(strcmp(argv[i], "-B") == 0 && i + 1 < argc)
+        {
+            balloon_target = strtoull(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-k") == 0)
+        {
+            mergeable = true;
+        }
+        else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            job_list_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            worker_cnt = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            job_timeout_ms = strtoull(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            fork_socket = argv[++i];
+        }
+        else if(argv[i][0] != '-' && image_path == NULL)
+        {
+            image_path = argv[i];
+        }
+        else
+        {
+            goto usage;
+        }
+    }
+
+    /* batch mode, every job of the list on its own machine in this process */
+    if(job_list_path != NULL)
+    {
+        if(worker_cnt <= 0)
+        {
+            worker_cnt = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+
+        la64_runner_t *runner = la64_runner_alloc(job_list_path, worker_cnt, job_timeout_ms);
+
+        if(runner == NULL)
+        {
+            return 1;
+        }
+
+        la64_runner_run(runner);
+        int failed = la64_runner_report(runner, stdout);
+        la64_runner_dealloc(runner);
+
+        return (failed != 0) ? 1 : 0;
+    }
+
+    if(image_path == NULL)
+    {
+        goto usage;
+    }
+
+    /* clones cannot share a network peer or segment id, nor keep what the guest put in -r regions */
+    if(fork_socket != NULL &&
+       (net_backend != NULL || shm_spec != NULL || ram_region_cnt != 0))
+    {
+        fprintf(stderr, "[!] -f cannot be combined with -n, -s or -r\n");
+        return 1;
+    }
+
     /* creating new la16 virtual machine */
-    la64_machine_t *machine = la64_machine_alloc(0x20000000);
+    la64_machine_t *machine = la64_machine_alloc(LA64_MACHINE_DEFAULT_MEMORY);
 
     if(machine == NULL)
     {
@@ -49,35 +197,158 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    /* load boot image */
-    if(!la64_memory_load_image(machine->memory, argv[1]))
+    /* extra ram regions, <base>,<size>[,<file>] with a file making it persistent */
+    for(int i = 0; i < ram_region_cnt; i++)
+    {
+        char *end = NULL;
+        uint64_t base = strtoull(ram_region[i], &end, 0);
+        uint64_t size = (*end == ',') ? strtoull(end + 1, &end, 0) : 0;
+        const char *path = (*end == ',') ? end + 1 : NULL;
+
+        if(!la64_memory_add_region(machine, base, size, path))
+        {
+            la64_machine_dealloc(machine);
+            return 1;
+        }
+    }
+
+    /* handing guest ram to ksm, identical pages across vms are kept once */
+    if(mergeable &&
+       !la64_memory_set_mergeable(machine->memory))
+    {
+        fprintf(stderr, "[!] failed to mark guest memory mergeable\n");
+    }
+
+    /* how much of its ram the guest is asked to give back */
+    machine->balloon->target = balloon_target / LA64_MMU_PAGE_SIZE;
+
+    /* clones map the ram of the fork server, so it has to be shareable before anything lands in it */
+    if(fork_socket != NULL)
+    {
+        if(!la64_memory_share(machine->memory))
+        {
+            la64_machine_dealloc(machine);
+            return 1;
+        }
+
+        machine->fork_server = true;
+        headless = true;
+    }
+
+    /* load boot image and point the core at its entry */
+    if(!la64_machine_boot(machine, image_path))
     {
         goto usage;
     }
 
-    /*
-     * getting entry point of boot image of virtual machine
-     * and setting program pointer of first core to it
-     */
-    bitwalker_t bw;
-    bitwalker_init_read(&bw, machine->memory->memory, 8, BW_LITTLE_ENDIAN);
-    machine->core->rl[LA64_REGISTER_PC] = bitwalker_read(&bw, 64);
+    /* the launching terminal unless the console was moved elsewhere */
+    if(!la64_uart_attach(machine->uart, uart_backend))
+    {
+        la64_machine_dealloc(machine);
+        return 1;
+    }
+
+    /* backing the block device with a host image */
+    if(disk_path != NULL &&
+       !la64_disk_attach(machine->disk, disk_path))
+    {
+        la64_machine_dealloc(machine);
+        return 1;
+    }
+
+    /* wiring the network device to another vm */
+    if(net_backend != NULL &&
+       !la64_net_attach(machine->net, net_backend))
+    {
+        la64_machine_dealloc(machine);
+        return 1;
+    }
 
-    /* setting stack pointer of  */
-    machine->core->rl[LA64_REGISTER_SP] = machine->memory->memory_size - 8;
+    /* joining the shared memory segment of cooperating vms */
+    if(shm_spec != NULL &&
+       !la64_shm_attach(machine->shm, shm_spec))
+    {
+        la64_machine_dealloc(machine);
+        return 1;
+    }
 
-    /* setting elevation to system monitor */
-    machine->core->rl[LA64_REGISTER_CR0] = LA64_ELEVATION_SECURE_MONITOR;
+#if defined(__linux__) || defined(__APPLE__)
+    /* headless display writes frames instead of opening a window */
+    if(headless)
+    {
+        machine->display->headless = true;
+    }
+
+    machine->display->dump_prefix = dump_prefix;
+    machine->display->dump_interval_ms = dump_interval_ms;
+
+    if(machine->display->headless &&
+       dump_prefix != NULL)
+    {
+        dump_display = machine->display;
+        signal(SIGUSR1, dump_signal_handler);
+    }
+#endif /* __linux__ || __APPLE__ */
+
+    /* attaching the sampling profiler if requested */
+    if(profile_path != NULL)
+    {
+        machine->profiler = la64_profiler_alloc(machine, profile_path, profile_hz);
+
+        if(machine->profiler == NULL)
+        {
+            fprintf(stderr, "[!] failed to allocate profiler\n");
+            return 1;
+        }
+
+        if(symbol_map_path != NULL &&
+           !la64_profiler_load_symbols(machine->profiler, symbol_map_path))
+        {
+            return 1;
+        }
+    }
 
     /* executing virtual machines 1st core TODO: Implement threading */
     la64_core_execute(machine->core);
 
+#if defined(__linux__) || defined(__APPLE__)
+    /* no dump may be requested from a display that is about to go away */
+    if(dump_display != NULL)
+    {
+        signal(SIGUSR1, SIG_IGN);
+        dump_display = NULL;
+    }
+#endif /* __linux__ || __APPLE__ */
+
+    /* the guest reached its fork point, from here on only clones run */
+    if(machine->ready)
+    {
+        la64_forkserver_t *server = la64_forkserver_alloc(machine, fork_socket, disk_path);
+
+        /* tearing the machine down leaves this process single threaded, safe to fork */
+        la64_machine_dealloc(machine);
+
+        if(server == NULL)
+        {
+            return 1;
+        }
+
+        la64_forkserver_run(server);
+        la64_forkserver_dealloc(server);
+
+        return 1;
+    }
+
+    /* whatever the guest left in the exit register */
+    int status = (int)(machine->exit_code & 0xFF);
+
     /* deallocating machine */
     la64_machine_dealloc(machine);
 
-    return 0;
+    return status;
 
 usage:
-    printf("%s <boot image>\n", (argv == NULL || argv[0] == NULL) ? "(nil)" : argv[0]);
+    printf("%s [-u stdio|pty|null|unix:<path>|file:<path>] [-b <disk image>] [-n unix:<local>,<peer>] [-s <name>,<size>,<id>] [-r <base>,<size>[,<file>]]... [-B <balloon bytes>] [-k] [-f <fork socket>] [-H] [-d <frame dump prefix> [-i <interval ms>]] [-p <folded profile> [-m <symbol map>] [-F <hz>]] <boot image>\n", (argv == NULL || argv[0] == NULL) ? "(nil)" : argv[0]);
+    printf("%s -j <job list> [-w <workers>] [-t <timeout ms>]\n", (argv == NULL || argv[0] == NULL) ? "(nil)" : argv[0]);
     return 1;
 }
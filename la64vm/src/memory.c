@@ -22,6 +22,9 @@
  * SOFTWARE.
  */
 
+/* memfd_create is gnu */
+#define _GNU_SOURCE
+
 #include <la64vm/memory.h>
 #include <la64vm/core.h>
 #include <la64vm/machine.h>
@@ -61,12 +64,31 @@ la64_memory_t *la64_memory_alloc(uint64_t size)
 
     /* setting property */
     memory->memory_size = size;
+    memory->fd = -1;
 
     return memory;
 }
 
 void la64_memory_dealloc(la64_memory_t *memory)
 {
+    for(int i = 0; i < memory->region_cnt; i++)
+    {
+        la64_memory_region_t *region = &memory->region[i];
+
+        /* making sure the file has it before the mapping goes */
+        if(region->persistent)
+        {
+            msync(region->memory, region->size, MS_SYNC);
+        }
+
+        munmap(region->memory, region->size);
+    }
+
+    if(memory->fd >= 0)
+    {
+        close(memory->fd);
+    }
+
     /* release the memory in case that its allocated */
     if(memory->memory != MAP_FAILED ||
        memory->memory != NULL)
@@ -86,7 +108,7 @@ bool la64_memory_load_image(la64_memory_t *memory,
     /* checking file descriptor */
     if(fd == -1)
     {
-        printf("[boot] failed to open boot image at path %s\n", image_path);
+        fprintf(stderr, "[boot] failed to open boot image at path %s\n", image_path);
         return false;
     }
 
@@ -95,7 +117,7 @@ bool la64_memory_load_image(la64_memory_t *memory,
 
     if(fstat(fd, &image_stat) != 0)
     {
-        printf("[boot] failed to gather size of file at path %s\n", image_path);
+        fprintf(stderr, "[boot] failed to gather size of file at path %s\n", image_path);
         return false;
     }
 
@@ -104,14 +126,14 @@ bool la64_memory_load_image(la64_memory_t *memory,
     /* checking if memory is big enough for our memory */
     if(image_size > memory->memory_size)
     {
-        printf("[boot] error: boot image is too large\n");
+        fprintf(stderr, "[boot] error: boot image is too large\n");
         return false;
     }
 
     /* loading boot image into memory */
     if(read(fd, memory->memory, image_size) <= 0)
     {
-        printf("[boot] error: reading boot image failed\n");
+        fprintf(stderr, "[boot] error: reading boot image failed\n");
         return false;
     }
 
@@ -120,6 +142,225 @@ bool la64_memory_load_image(la64_memory_t *memory,
     return true;
 }
 
+bool la64_memory_add_region(la64_machine_t *machine,
+                            uint64_t base,
+                            uint64_t size,
+                            const char *path)
+{
+    la64_memory_t *memory = machine->memory;
+
+    /* regions are page granular and may not shadow the main block */
+    if(memory->region_cnt >= LA64_MEMORY_MAX_REGIONS ||
+       size == 0 ||
+       (base | size) & (LA64_MMU_PAGE_SIZE - 1) ||
+       base < memory->memory_size ||
+       base + size < base)
+    {
+        printf("[memory] invalid ram region 0x%llx+0x%llx\n", (unsigned long long)base, (unsigned long long)size);
+        return false;
+    }
+
+    la64_memory_region_t *region = &memory->region[memory->region_cnt];
+    region->memory = MAP_FAILED;
+
+    if(path == NULL)
+    {
+        region->memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    else
+    {
+        /* the file is the memory, created or grown as needed and never shrunk */
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+        if(fd == -1)
+        {
+            printf("[memory] failed to open ram backing at path %s\n", path);
+            return false;
+        }
+
+        struct stat backing_stat;
+
+        if(fstat(fd, &backing_stat) == 0 &&
+           (uint64_t)backing_stat.st_size < size &&
+           ftruncate(fd, size) != 0)
+        {
+            printf("[memory] failed to grow ram backing at path %s\n", path);
+            close(fd);
+            return false;
+        }
+
+        region->memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        /* the mapping keeps the file alive */
+        close(fd);
+    }
+
+    if(region->memory == MAP_FAILED)
+    {
+        printf("[memory] failed to map ram region 0x%llx+0x%llx\n", (unsigned long long)base, (unsigned long long)size);
+        return false;
+    }
+
+    /* guest loads, stores and device dma reach it through the bus like any ram region */
+    if(!la64_mmio_register_ram(machine->mmio_bus, base, size, region->memory, NULL, 0))
+    {
+        printf("[memory] ram region 0x%llx+0x%llx overlaps\n", (unsigned long long)base, (unsigned long long)size);
+        munmap(region->memory, size);
+        return false;
+    }
+
+    region->base = base;
+    region->size = size;
+    region->persistent = (path != NULL);
+    memory->region_cnt++;
+
+    return true;
+}
+
+bool la64_memory_discard(la64_memory_t *memory,
+                         uint64_t addr,
+                         uint64_t size,
+                         bool lazy)
+{
+    uint64_t addr_end = addr + size;
+
+    /* page granular, the guest gives up whole pages only */
+    if(size == 0 ||
+       (addr | size) & (LA64_MMU_PAGE_SIZE - 1) ||
+       addr_end < addr)
+    {
+        return false;
+    }
+
+    uint8_t *ptr = NULL;
+    bool main_block = false;
+
+    if(addr_end <= memory->memory_size)
+    {
+        ptr = &(memory->memory[addr]);
+        main_block = true;
+    }
+
+    /* persistent regions are the guests file, dropping them would not free anything */
+    for(int i = 0; ptr == NULL && i < memory->region_cnt; i++)
+    {
+        la64_memory_region_t *region = &memory->region[i];
+
+        if(!region->persistent &&
+           addr >= region->base &&
+           addr_end <= region->base + region->size)
+        {
+            ptr = &(region->memory[addr - region->base]);
+        }
+    }
+
+    if(ptr == NULL)
+    {
+        return false;
+    }
+
+    /* dropping pages of a shared block only unmaps them, the memfd keeps the data */
+    if(main_block && memory->fd >= 0)
+    {
+#if defined(__linux__)
+        return fallocate(memory->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)addr, (off_t)size) == 0;
+#else
+        memset(ptr, 0, size);
+        return true;
+#endif /* __linux__ */
+    }
+
+    /* in a clone they would come back as the snapshot, fresh zero pages replace the copies */
+    if(main_block && memory->cloned)
+    {
+        return mmap(ptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED;
+    }
+
+    /* the pages read back as zero (or unchanged if lazy and never reclaimed) */
+#ifdef MADV_FREE
+    if(lazy)
+    {
+        return madvise(ptr, size, MADV_FREE) == 0;
+    }
+#endif /* MADV_FREE */
+
+    return madvise(ptr, size, MADV_DONTNEED) == 0;
+}
+
+bool la64_memory_set_mergeable(la64_memory_t *memory)
+{
+#ifdef MADV_MERGEABLE
+    /* letting ksm fold identical pages across vms */
+    if(madvise(memory->memory, memory->memory_size, MADV_MERGEABLE) != 0)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < memory->region_cnt; i++)
+    {
+        la64_memory_region_t *region = &memory->region[i];
+
+        if(!region->persistent &&
+           madvise(region->memory, region->size, MADV_MERGEABLE) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif /* MADV_MERGEABLE */
+}
+
+bool la64_memory_share(la64_memory_t *memory)
+{
+    /* nothing was loaded yet, so there is nothing to carry over */
+#if defined(__linux__)
+    int fd = memfd_create("la64-ram", MFD_CLOEXEC);
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/la64-ram-%d", (int)getpid());
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    shm_unlink(name);
+#endif /* __linux__ */
+
+    if(fd < 0)
+    {
+        printf("[memory] failed to create shared ram\n");
+        return false;
+    }
+
+    /* same host address, so nothing that already points into ram goes stale */
+    if(ftruncate(fd, memory->memory_size) != 0 ||
+       mmap(memory->memory, memory->memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        printf("[memory] failed to map shared ram\n");
+        close(fd);
+        return false;
+    }
+
+    memory->fd = fd;
+
+    return true;
+}
+
+bool la64_memory_clone(la64_memory_t *memory,
+                       int fd)
+{
+    /* private over the shared block, pages get copied on the first store only */
+    if(mmap(memory->memory, memory->memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        printf("[memory] failed to map cloned ram\n");
+        return false;
+    }
+
+    memory->cloned = true;
+
+    return true;
+}
+
 void *la64_memory_access(la64_core_t *core,
                          uint64_t addr,
                          size_t size)
@@ -130,13 +371,91 @@ void *la64_memory_access(la64_core_t *core,
     uint64_t addr_end = addr + size;
 
     /* wrap around check */
-    if(addr >= addr_end ||
-       core->machine->memory->memory_size < addr_end)
+    if(addr >= addr_end)
+    {
+        return NULL;
+    }
+
+    la64_memory_t *memory = core->machine->memory;
+
+    if(addr_end <= memory->memory_size)
+    {
+        return &(memory->memory[addr]);
+    }
+
+    /* code and page tables may live in the extra regions too */
+    for(int i = 0; i < memory->region_cnt; i++)
+    {
+        la64_memory_region_t *region = &memory->region[i];
+
+        if(addr >= region->base &&
+           addr_end <= region->base + region->size)
+        {
+            return &(region->memory[addr - region->base]);
+        }
+    }
+
+    return NULL;
+}
+
+static void *la64_memory_access_region(la64_mmio_region_t *region,
+                                       uint64_t addr,
+                                       size_t size)
+{
+    /* accesses may not straddle the end of a ram backed region, nor wrap around */
+    if(size > region->size - (addr - region->base_addr))
     {
         return NULL;
     }
 
-    return &(core->machine->memory->memory[addr]);
+    return &(region->ram[addr - region->base_addr]);
+}
+
+void *la64_memory_map(la64_machine_t *machine,
+                      uint64_t addr,
+                      size_t size,
+                      bool write)
+{
+    assert(size != 0);
+
+    /* physical only, meant for devices doing dma */
+    la64_mmio_region_t *mmio = la64_mmio_find(machine->mmio_bus, addr);
+
+    if(mmio != NULL)
+    {
+        /* callback devices cannot be mapped, read only ram only for reading */
+        if(mmio->ram == NULL ||
+           (write && mmio->readonly))
+        {
+            return NULL;
+        }
+
+        return la64_memory_access_region(mmio, addr, size);
+    }
+
+    /* wrap around check */
+    if(addr + size <= addr ||
+       machine->memory->memory_size < addr + size)
+    {
+        return NULL;
+    }
+
+    return &(machine->memory->memory[addr]);
+}
+
+void la64_memory_mark_dirty(la64_machine_t *machine,
+                            uint64_t addr,
+                            size_t size)
+{
+    la64_mmio_region_t *mmio = la64_mmio_find(machine->mmio_bus, addr);
+
+    /* devices call this after their writes to a range they mapped, so it is in bounds */
+    if(mmio != NULL &&
+       mmio->dirty != NULL &&
+       la64_memory_access_region(mmio, addr, size) != NULL)
+    {
+        la64_mmio_mark_dirty(mmio, addr, size);
+    }
 }
 
 bool la64_memory_read(la64_core_t *core,
@@ -152,9 +471,19 @@ bool la64_memory_read(la64_core_t *core,
     /* finding mmio device */
     la64_mmio_region_t *mmio = la64_mmio_find(core->machine->mmio_bus, addr);
 
+    /* host pointer, if the access ends up being a plain memory access */
+    void *ptr = NULL;
+
     /* checking if address was indeed assigned to a MMIO device */
-    if(mmio != NULL)
+    if(mmio != NULL &&
+       mmio->ram != NULL)
     {
+        ptr = la64_memory_access_region(mmio, addr, size);
+    }
+    else if(mmio != NULL)
+    {
+        la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_MMIO);
+
         /* getting value of MMIO device */
         if(mmio->read != NULL)
         {
@@ -163,9 +492,11 @@ bool la64_memory_read(la64_core_t *core,
         }
         return false;
     }
-
-    /* accessing memory TODO: implement page tables */
-    void *ptr = la64_memory_access(core, addr, size);
+    else
+    {
+        /* accessing memory TODO: implement page tables */
+        ptr = la64_memory_access(core, addr, size);
+    }
 
     /* checking if memory access was successful */
     if(ptr == NULL)
@@ -173,6 +504,8 @@ bool la64_memory_read(la64_core_t *core,
         return false;
     }
 
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_LOADS);
+
     /* perform read from memory */
     switch(size)
     {
@@ -206,9 +539,24 @@ bool la64_memory_write(la64_core_t *core,
     /* trying to find mmio device */
     la64_mmio_region_t *mmio = la64_mmio_find(core->machine->mmio_bus, addr);
 
+    /* host pointer, if the access ends up being a plain memory access */
+    void *ptr = NULL;
+
     /* null pointer checking potential mmio device */
-    if(mmio != NULL)
+    if(mmio != NULL &&
+       mmio->ram != NULL)
+    {
+        if(mmio->readonly)
+        {
+            return false;
+        }
+
+        ptr = la64_memory_access_region(mmio, addr, size);
+    }
+    else if(mmio != NULL)
     {
+        la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_MMIO);
+
         /* performing mmio write */
         if(mmio->write != NULL)
         {
@@ -217,9 +565,11 @@ bool la64_memory_write(la64_core_t *core,
         }
         return false;
     }
-
-    /* accessing memory TODO: implement page tables */
-    void *ptr = la64_memory_access(core, addr, size);
+    else
+    {
+        /* accessing memory TODO: implement page tables */
+        ptr = la64_memory_access(core, addr, size);
+    }
 
     /* checking if memory access was successful */
     if(ptr == NULL)
@@ -227,21 +577,32 @@ bool la64_memory_write(la64_core_t *core,
         return false;
     }
 
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_STORES);
+
     switch(size)
     {
         case 1:
             *(uint8_t *)ptr = (uint8_t)value;
-            return true;
+            break;
         case 2:
             *(uint16_t *)ptr = (uint16_t)value;
-            return true;
+            break;
         case 4:
             *(uint32_t *)ptr = (uint32_t)value;
-            return true;
+            break;
         case 8:
             *(uint64_t *)ptr = value;
-            return true;
+            break;
         default:
             return false;
     }
+
+    /* only once the store landed, a consumer clearing the flag has to see it */
+    if(mmio != NULL &&
+       mmio->dirty != NULL)
+    {
+        la64_mmio_mark_dirty(mmio, addr, size);
+    }
+
+    return true;
 }
@@ -65,6 +65,9 @@ bool la64_mmio_register(la64_mmio_bus_t *bus,
     region->device = device;
     region->read = read;
     region->write = write;
+    region->ram = NULL;
+    region->dirty = NULL;
+    region->readonly = false;
 
     /* check and set addresses */
     if(bus->start_addr > base)
@@ -81,6 +84,43 @@ bool la64_mmio_register(la64_mmio_bus_t *bus,
     return true;
 }
 
+bool la64_mmio_register_ram(la64_mmio_bus_t *bus,
+                            uint64_t base,
+                            uint64_t size,
+                            uint8_t *ram,
+                            atomic_uchar *dirty,
+                            uint8_t dirty_shift)
+{
+    if(!la64_mmio_register(bus, base, size, NULL, NULL, NULL))
+    {
+        return false;
+    }
+
+    /* loads and stores hit the backing directly, no callbacks involved */
+    la64_mmio_region_t *region = &bus->regions[bus->region_count - 1];
+    region->ram = ram;
+    region->dirty = dirty;
+    region->dirty_shift = dirty_shift;
+
+    return true;
+}
+
+bool la64_mmio_register_rom(la64_mmio_bus_t *bus,
+                            uint64_t base,
+                            uint64_t size,
+                            uint8_t *ram)
+{
+    if(!la64_mmio_register_ram(bus, base, size, ram, NULL, 0))
+    {
+        return false;
+    }
+
+    /* host owned, guest stores fault */
+    bus->regions[bus->region_count - 1].readonly = true;
+
+    return true;
+}
+
 la64_mmio_region_t *la64_mmio_find(la64_mmio_bus_t *bus,
                                    uint64_t addr)
 {
@@ -91,12 +131,14 @@ la64_mmio_region_t *la64_mmio_find(la64_mmio_bus_t *bus,
         return NULL;
     }
 
-    /* fast path */
-    if(bus->last_region != NULL &&
-        addr >= bus->last_region->base_addr &&
-        addr < bus->last_region->base_addr + bus->last_region->size)
+    /* fast path, loaded once as device threads look up regions too */
+    la64_mmio_region_t *last = bus->last_region;
+
+    if(last != NULL &&
+        addr >= last->base_addr &&
+        addr < last->base_addr + last->size)
     {
-        return bus->last_region;
+        return last;
     }
 
     /* finding mmio region, hopefully x3 */
@@ -25,42 +25,35 @@
 #include <la64vm/mmu.h>
 #include <la64vm/core.h>
 #include <la64vm/machine.h>
+#include <la64vm/memory.h>
 #include <stdio.h>
 
-static bool la64_mmu_access_ctable(la64_core_t *core,
-                                   uint64_t ptbase,
-                                   uint16_t idx,
-                                   uint64_t *oaddr)
+static la64_mmu_entry_t *la64_mmu_entry(la64_core_t *core,
+                                        uint64_t ptbase,
+                                        uint16_t idx)
 {
-    la64_mmu_entry_t *table = (la64_mmu_entry_t *)&core->machine->memory->memory[ptbase];
-    la64_mmu_entry_t entry = table[idx];
+    /* a table outside of ram is as good as not present */
+    la64_mmu_entry_t *table = la64_memory_access(core, ptbase, LA64_MMU_PAGE_SIZE);
 
-    la64_mmu_flag_t flag = entry & LA64_MMU_MASK_FLAGS;
-
-    if(!(flag & LA64_MMU_PT_PRESENT))
+    if(table == NULL)
     {
-        return false;
+        return NULL;
     }
 
-    la64_mmu_pfn_t pfn = (entry & LA64_MMU_MASK_PFN) >> 8;
-
-    *oaddr = pfn << 13;
-
-    return true;
+    return &table[idx];
 }
 
-static bool la64_mmu_access_l1(la64_core_t *core,
-                               uint64_t ptbase,
-                               uint16_t idx,
-                               uint8_t acc,
-                               uint64_t *oaddr)
+static bool la64_mmu_access_leaf(la64_core_t *core,
+                                 la64_mmu_entry_t entry,
+                                 uint8_t acc,
+                                 uint64_t *fsr)
 {
-    la64_mmu_entry_t *table = (la64_mmu_entry_t *)&core->machine->memory->memory[ptbase];
-    la64_mmu_entry_t entry = table[idx];
-
     la64_mmu_flag_t flag = entry & LA64_MMU_MASK_FLAGS;
     la64_mmu_flag_t checkflg = 0;
 
+    /* the page is there, only its permissions can refuse */
+    *fsr |= LA64_MMU_FAULT_PRESENT;
+
     /* permission switch */
     switch(acc)
     {
@@ -74,12 +67,9 @@ static bool la64_mmu_access_l1(la64_core_t *core,
             checkflg = LA64_MMU_PT_EXEC;
             break;
         default:
-            /* TODO: cause pagefault */
             return false;
     }
 
-    checkflg |= LA64_MMU_PT_PRESENT;
-
     /* if CR0 is user then we need to add user check too */
     if(core->rl[LA64_REGISTER_CR0] < LA64_ELEVATION_KERNEL)
     {
@@ -87,86 +77,232 @@ static bool la64_mmu_access_l1(la64_core_t *core,
     }
 
     /* action permission check */
-    if((flag & checkflg) != checkflg)
+    return (flag & checkflg) == checkflg;
+}
+
+static bool la64_mmu_walk(la64_core_t *core,
+                          uint64_t vaddr,
+                          uint8_t acc,
+                          uint64_t *paddr,
+                          la64_mmu_flag_t *flags,
+                          uint64_t *fsr,
+                          bool probe)
+{
+    /*
+     * we read CR4 as if it was a 5th level entry, but its just a
+     * control register.. for simplicity we do that hahaha.
+     */
+    la64_mmu_pfn_t l5_pfn = (core->rl[LA64_REGISTER_CR4] & LA64_MMU_MASK_PFN) >> 8;
+
+    /* each level resolves 10 bits of the address, l4 first */
+    uint64_t table = l5_pfn << 13;
+
+    for(int shift = LA64_MMU_L4_SHIFT; shift >= LA64_MMU_L1_SHIFT; shift -= 10)
     {
-        /* TODO: cause page fault */
-        return false;
-    }
+        la64_mmu_entry_t *entry = la64_mmu_entry(core, table, (vaddr >> shift) & 0x3FF);
+
+        if(entry == NULL ||
+           !(*entry & LA64_MMU_PT_PRESENT))
+        {
+            return false;
+        }
 
-    la64_mmu_pfn_t pfn = (entry & LA64_MMU_MASK_PFN) >> 8;
+        la64_mmu_pfn_t pfn = (*entry & LA64_MMU_MASK_PFN) >> 8;
 
-    *oaddr = pfn << 13;
+        /* l3 and l2 entries may map everything below them as one large page */
+        if(shift == LA64_MMU_L1_SHIFT ||
+           (shift != LA64_MMU_L4_SHIFT && (*entry & LA64_MMU_PT_LARGE)))
+        {
+            if(!la64_mmu_access_leaf(core, *entry, acc, fsr))
+            {
+                return false;
+            }
 
-    return true;
+            /* accessed and dirty are only ever set, and only written when they change */
+            la64_mmu_entry_t update = LA64_MMU_PT_ACCESSED;
+
+            if(acc == LA64_MMU_ACC_WRITE)
+            {
+                update |= LA64_MMU_PT_DIRTY;
+            }
+
+            la64_mmu_entry_t value = *entry;
+
+            if(!probe &&
+               (value & update) != update)
+            {
+                value = __atomic_or_fetch(entry, update, __ATOMIC_RELAXED);
+            }
+
+            /* the low bits of a large page frame are ignored, the offset takes their place */
+            uint64_t offset = vaddr & ((1ULL << shift) - 1);
+
+            *paddr = ((pfn << 13) & ~((1ULL << shift) - 1)) + offset;
+            *flags = value & LA64_MMU_MASK_FLAGS;
+
+            return true;
+        }
+
+        table = pfn << 13;
+    }
+
+    return false;
 }
 
-bool la64_mmu_access(la64_core_t *core,
-                     uint64_t vaddr,
-                     uint8_t acc,
-                     uint64_t *paddr)
+static bool la64_mmu_translate(la64_core_t *core,
+                               uint64_t vaddr,
+                               uint8_t acc,
+                               uint64_t *paddr,
+                               uint64_t *fsr,
+                               bool probe)
 {
-    /* vaddr cannot be bigger than 53bits */
-    if(vaddr >> 53)
+    /* status of the fault, should there be one */
+    uint64_t status = (acc & LA64_MMU_FAULT_ACC);
+
+    if(core->rl[LA64_REGISTER_CR0] < LA64_ELEVATION_KERNEL)
     {
-        return false;
+        status |= LA64_MMU_FAULT_USER;
     }
 
-    /*
-     * find out if paging is enabled, if not write vaddr to paddr,
-     * because that means paddr is vaddr because virtual addressing
-     * is already off.
-     *
-     * we read it as if it was a 5th level entry, but its just a
-     * control register.. for simplicity we do that hahaha.
-     */
-    la64_mmu_entry_t l5_entry = core->rl[LA64_REGISTER_CR4];
+    *fsr = status;
 
-    /* gather its flag and check if paging is enabled */
-    la64_mmu_flag_t l5_flag = l5_entry & LA64_MMU_MASK_FLAGS;
-
-    if(!(l5_flag & LA64_MMU_PT_PRESENT) ||
-       core->in_interrupt)
+    /* incase paging is disabled virtual addresses are physical ones */
+    if(!la64_mmu_enabled(core))
     {
-        /* incase paging is disabled virtual addresses are physical ones */
         *paddr = vaddr;
         return true;
     }
 
-    /* get pfn of control register */
-    la64_mmu_pfn_t l5_pfn = (l5_entry & LA64_MMU_MASK_PFN) >> 8;
-
-    /* precalculating all indexes */
-    uint16_t offset =  vaddr        & 0x1FFF;      /* 13bit offset (addressing within a page) */
-    uint16_t l1_idx = (vaddr >> 13) & 0x3FF;       /* 10 bits for each index  */
-    uint16_t l2_idx = (vaddr >> 23) & 0x3FF;
-    uint16_t l3_idx = (vaddr >> 33) & 0x3FF;
-    uint16_t l4_idx = (vaddr >> 43) & 0x3FF;
-
-    /* now we calculate the address where the physical frame is */
-    uint64_t l1_addr = 0;
-    uint64_t l2_addr = 0;
-    uint64_t l3_addr = 0;
-    uint64_t l4_addr = l5_pfn << 13;
-
-    /* now access each table */
-    if(!la64_mmu_access_ctable(core, l4_addr, l4_idx, &l3_addr) ||
-       !la64_mmu_access_ctable(core, l3_addr, l3_idx, &l2_addr) ||
-       !la64_mmu_access_ctable(core, l2_addr, l2_idx, &l1_addr))
+    /* vaddr cannot be bigger than 53bits */
+    if(vaddr >> 53)
     {
         return false;
     }
 
+    uint64_t ptb = core->rl[LA64_REGISTER_CR4];
+    uint8_t asid = (ptb >> LA64_MMU_ASID_SHIFT) & LA64_MMU_ASID_MASK;
+
+    /* the tables moved without a new asid, so whatever that asid cached is stale */
+    if(ptb != core->tlb_ptb)
+    {
+        if(((ptb ^ core->tlb_ptb) & LA64_MMU_MASK_PFN) &&
+           asid == ((core->tlb_ptb >> LA64_MMU_ASID_SHIFT) & LA64_MMU_ASID_MASK))
+        {
+            la64_mmu_invalidate_asid(core, asid);
+        }
+
+        core->tlb_ptb = ptb;
+    }
+
+    uint64_t vpn = vaddr >> LA64_MMU_L1_SHIFT;
+    la64_tlb_entry_t *tlb = &core->tlb[vpn & (LA64_TLB_ENTRIES - 1)];
+
     /*
-     * now were at the l1 table, now things get very interesting
-     * we need to extract the flags now and such..
+     * filling set the accessed bit already, a clean entry has to
+     * walk once more on the first write so the leaf turns dirty.
      */
-    uint64_t paddr_raw = 0;
-    if(!la64_mmu_access_l1(core, l1_addr, l1_idx, acc, &paddr_raw))
+    if(tlb->valid &&
+       tlb->vpn == vpn &&
+       (tlb->global || tlb->asid == asid) &&
+       (acc != LA64_MMU_ACC_WRITE || (tlb->flags & LA64_MMU_PT_DIRTY)))
+    {
+        if(la64_mmu_access_leaf(core, tlb->flags, acc, fsr))
+        {
+            *paddr = tlb->frame + (vaddr & (LA64_MMU_PAGE_SIZE - 1));
+            return true;
+        }
+
+        /* the tables may have granted more since, a refusal always walks */
+        *fsr = status;
+    }
+
+    la64_mmu_flag_t flags = 0;
+
+    if(probe)
+    {
+        return la64_mmu_walk(core, vaddr, acc, paddr, &flags, fsr, true);
+    }
+
+    la64_pmu_event(core->machine->pmu, core, LA64_PMU_EVENT_TLB_MISSES);
+
+    if(!la64_mmu_walk(core, vaddr, acc, paddr, &flags, fsr, false))
     {
         return false;
     }
 
-    *paddr = paddr_raw + offset;
+    /* large pages are cached in 8K pieces, one per page actually touched */
+    tlb->vpn = vpn;
+    tlb->frame = *paddr & ~((uint64_t)LA64_MMU_PAGE_SIZE - 1);
+    tlb->flags = flags;
+    tlb->asid = asid;
+    tlb->global = (flags & LA64_MMU_PT_GLOBAL) != 0;
+    tlb->valid = true;
 
     return true;
 }
+
+bool la64_mmu_access(la64_core_t *core,
+                     uint64_t vaddr,
+                     uint8_t acc,
+                     uint64_t *paddr)
+{
+    uint64_t fsr = 0;
+
+    if(la64_mmu_translate(core, vaddr, acc, paddr, &fsr, false))
+    {
+        return true;
+    }
+
+    /* recording the fault, the core turns it into a page fault exception */
+    core->rl[LA64_REGISTER_CR5] = vaddr;
+    core->rl[LA64_REGISTER_CR6] = fsr;
+    core->page_fault = true;
+
+    return false;
+}
+
+bool la64_mmu_probe(la64_core_t *core,
+                    uint64_t vaddr,
+                    uint8_t acc,
+                    uint64_t *paddr)
+{
+    /* same walk, but nothing about the guest changes when it fails */
+    uint64_t fsr = 0;
+    return la64_mmu_translate(core, vaddr, acc, paddr, &fsr, true);
+}
+
+void la64_mmu_invalidate_all(la64_core_t *core)
+{
+    for(int i = 0; i < LA64_TLB_ENTRIES; i++)
+    {
+        core->tlb[i].valid = false;
+    }
+}
+
+void la64_mmu_invalidate_asid(la64_core_t *core,
+                              uint8_t asid)
+{
+    /* global entries belong to every asid and stay */
+    for(int i = 0; i < LA64_TLB_ENTRIES; i++)
+    {
+        if(!core->tlb[i].global &&
+           core->tlb[i].asid == asid)
+        {
+            core->tlb[i].valid = false;
+        }
+    }
+}
+
+void la64_mmu_invalidate_addr(la64_core_t *core,
+                              uint8_t asid,
+                              uint64_t vaddr)
+{
+    uint64_t vpn = vaddr >> LA64_MMU_L1_SHIFT;
+    la64_tlb_entry_t *tlb = &core->tlb[vpn & (LA64_TLB_ENTRIES - 1)];
+
+    if(tlb->vpn == vpn &&
+       (tlb->global || tlb->asid == asid))
+    {
+        tlb->valid = false;
+    }
+}
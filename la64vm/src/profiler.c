@@ -0,0 +1,396 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <la64vm/profiler.h>
+#include <la64vm/machine.h>
+#include <la64vm/memory.h>
+#include <la64vm/mmu.h>
+
+#define LA64_PROFILER_STACK_CAP_INITIAL 1024
+
+la64_profiler_t *la64_profiler_alloc(la64_machine_t *machine,
+                                     const char *output_path,
+                                     uint64_t hz)
+{
+    /* null pointer check */
+    if(machine == NULL ||
+       output_path == NULL)
+    {
+        return NULL;
+    }
+
+    /* allocating profiler */
+    la64_profiler_t *profiler = calloc(1, sizeof(la64_profiler_t));
+
+    if(profiler == NULL)
+    {
+        return NULL;
+    }
+
+    profiler->output_path = strdup(output_path);
+    profiler->stack_cap = LA64_PROFILER_STACK_CAP_INITIAL;
+    profiler->stack = calloc(profiler->stack_cap, sizeof(la64_profiler_stack_t));
+
+    if(profiler->output_path == NULL ||
+       profiler->stack == NULL)
+    {
+        free(profiler->output_path);
+        free(profiler->stack);
+        free(profiler);
+        return NULL;
+    }
+
+    /* converting the sampling frequency to host cycles, the unit the core loop ticks in */
+    if(hz == 0)
+    {
+        hz = LA64_PROFILER_DEFAULT_HZ;
+    }
+
+    profiler->interval = machine->timer->host_freq / hz;
+
+    if(profiler->interval == 0)
+    {
+        profiler->interval = 1;
+    }
+
+    profiler->next_sample = la64_get_host_cycles() + profiler->interval;
+
+    return profiler;
+}
+
+void la64_profiler_dealloc(la64_profiler_t *profiler)
+{
+    /* null pointer check */
+    if(profiler == NULL)
+    {
+        return;
+    }
+
+    /* flushing what we collected */
+    la64_profiler_write(profiler);
+
+    for(uint64_t i = 0; i < profiler->symbol_cnt; i++)
+    {
+        free(profiler->symbol[i].name);
+    }
+
+    free(profiler->symbol);
+    free(profiler->stack);
+    free(profiler->output_path);
+    free(profiler);
+}
+
+static int la64_profiler_symbol_compare(const void *a,
+                                        const void *b)
+{
+    const la64_profiler_symbol_t *sa = a;
+    const la64_profiler_symbol_t *sb = b;
+
+    if(sa->addr == sb->addr)
+    {
+        return 0;
+    }
+
+    return (sa->addr < sb->addr) ? -1 : 1;
+}
+
+bool la64_profiler_load_symbols(la64_profiler_t *profiler,
+                                const char *map_path)
+{
+    /* open symbol map produced by la64asm -m */
+    FILE *fp = fopen(map_path, "r");
+
+    if(fp == NULL)
+    {
+        printf("[profiler] failed to open symbol map at path %s\n", map_path);
+        return false;
+    }
+
+    unsigned long long addr;
+    char type;
+    char name[256];
+    uint64_t cap = profiler->symbol_cnt;
+
+    while(fscanf(fp, "%llx %c %255s", &addr, &type, name) == 3)
+    {
+        /* local labels and data would split up functions, so only global labels count */
+        if(type != 'T')
+        {
+            continue;
+        }
+
+        if(profiler->symbol_cnt == cap)
+        {
+            cap = (cap == 0) ? 64 : cap * 2;
+            la64_profiler_symbol_t *symbol = realloc(profiler->symbol, cap * sizeof(la64_profiler_symbol_t));
+
+            if(symbol == NULL)
+            {
+                fclose(fp);
+                return false;
+            }
+
+            profiler->symbol = symbol;
+        }
+
+        profiler->symbol[profiler->symbol_cnt].addr = addr;
+        profiler->symbol[profiler->symbol_cnt++].name = strdup(name);
+    }
+
+    fclose(fp);
+
+    qsort(profiler->symbol, profiler->symbol_cnt, sizeof(la64_profiler_symbol_t), la64_profiler_symbol_compare);
+
+    return true;
+}
+
+static la64_profiler_symbol_t *la64_profiler_symbolize(la64_profiler_t *profiler,
+                                                       uint64_t pc)
+{
+    /* binary search for the last symbol at or below pc */
+    uint64_t lo = 0;
+    uint64_t hi = profiler->symbol_cnt;
+
+    while(lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if(profiler->symbol[mid].addr <= pc)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return (lo == 0) ? NULL : &(profiler->symbol[lo - 1]);
+}
+
+static bool la64_profiler_peek(la64_core_t *core,
+                               uint64_t vaddr,
+                               uint64_t *value)
+{
+    /* translating the way the core would */
+    uint64_t paddr = 0;
+
+    if(!la64_mmu_probe(core, vaddr, LA64_MMU_ACC_READ, &paddr))
+    {
+        return false;
+    }
+
+    uint64_t *ptr = la64_memory_access(core, paddr, sizeof(uint64_t));
+
+    if(ptr == NULL)
+    {
+        return false;
+    }
+
+    *value = *ptr;
+    return true;
+}
+
+static uint64_t la64_profiler_hash(const uint64_t *pc,
+                                   uint8_t depth)
+{
+    /* FNV-1a over the raw frame addresses */
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for(uint8_t i = 0; i < depth; i++)
+    {
+        hash ^= pc[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static bool la64_profiler_grow(la64_profiler_t *profiler)
+{
+    uint64_t cap = profiler->stack_cap * 2;
+    la64_profiler_stack_t *stack = calloc(cap, sizeof(la64_profiler_stack_t));
+
+    if(stack == NULL)
+    {
+        return false;
+    }
+
+    /* rehashing all stacks into the new table */
+    for(uint64_t i = 0; i < profiler->stack_cap; i++)
+    {
+        if(profiler->stack[i].count == 0)
+        {
+            continue;
+        }
+
+        uint64_t slot = profiler->stack[i].hash & (cap - 1);
+
+        while(stack[slot].count != 0)
+        {
+            slot = (slot + 1) & (cap - 1);
+        }
+
+        stack[slot] = profiler->stack[i];
+    }
+
+    free(profiler->stack);
+    profiler->stack = stack;
+    profiler->stack_cap = cap;
+
+    return true;
+}
+
+void la64_profiler_sample(la64_profiler_t *profiler,
+                          la64_core_t *core)
+{
+    uint64_t pc[LA64_PROFILER_MAX_DEPTH];
+    uint8_t depth = 0;
+
+    pc[depth++] = core->rl[LA64_REGISTER_PC];
+
+    /* the interrupt frame is the only one not built by bl */
+    uint64_t irq_fp = core->in_interrupt ? (core->rl[LA64_REGISTER_CR1] - LA64_PROFILER_IRQ_FRAME_SIZE) : 0;
+
+    /* walking the FP chain, stack grows downwards so each caller frame must lie above */
+    uint64_t fp = core->rl[LA64_REGISTER_FP];
+
+    while(fp != 0 &&
+          depth < LA64_PROFILER_MAX_DEPTH)
+    {
+        uint64_t ra = 0;
+        uint64_t next_fp = 0;
+
+        if(!la64_profiler_peek(core, fp + ((fp == irq_fp) ? LA64_PROFILER_IRQ_FRAME_PC : LA64_PROFILER_FRAME_RA), &ra) ||
+           !la64_profiler_peek(core, fp + LA64_PROFILER_FRAME_FP, &next_fp))
+        {
+            break;
+        }
+
+        /* return addresses point past bl, which might already be the next symbol */
+        pc[depth++] = (fp == irq_fp) ? ra : ra - 1;
+
+        if(next_fp <= fp)
+        {
+            break;
+        }
+
+        fp = next_fp;
+    }
+
+    /* folding frames onto their symbol so stacks only differ by function */
+    for(uint8_t i = 0; i < depth; i++)
+    {
+        la64_profiler_symbol_t *symbol = la64_profiler_symbolize(profiler, pc[i]);
+
+        if(symbol != NULL)
+        {
+            pc[i] = symbol->addr;
+        }
+    }
+
+    /* keep the table at most half full */
+    if((profiler->stack_cnt + 1) * 2 > profiler->stack_cap &&
+       !la64_profiler_grow(profiler))
+    {
+        return;
+    }
+
+    uint64_t hash = la64_profiler_hash(pc, depth);
+    uint64_t slot = hash & (profiler->stack_cap - 1);
+
+    while(profiler->stack[slot].count != 0)
+    {
+        la64_profiler_stack_t *stack = &(profiler->stack[slot]);
+
+        if(stack->hash == hash &&
+           stack->depth == depth &&
+           memcmp(stack->pc, pc, depth * sizeof(uint64_t)) == 0)
+        {
+            stack->count++;
+            profiler->sample_cnt++;
+            return;
+        }
+
+        slot = (slot + 1) & (profiler->stack_cap - 1);
+    }
+
+    /* first time we see this stack */
+    la64_profiler_stack_t *stack = &(profiler->stack[slot]);
+    stack->hash = hash;
+    stack->count = 1;
+    stack->depth = depth;
+    memcpy(stack->pc, pc, depth * sizeof(uint64_t));
+
+    profiler->stack_cnt++;
+    profiler->sample_cnt++;
+}
+
+bool la64_profiler_write(la64_profiler_t *profiler)
+{
+    FILE *fp = fopen(profiler->output_path, "w");
+
+    if(fp == NULL)
+    {
+        printf("[profiler] failed to open output at path %s\n", profiler->output_path);
+        return false;
+    }
+
+    /* one line per unique stack, outermost frame first as flamegraph.pl expects it */
+    for(uint64_t i = 0; i < profiler->stack_cap; i++)
+    {
+        la64_profiler_stack_t *stack = &(profiler->stack[i]);
+
+        if(stack->count == 0)
+        {
+            continue;
+        }
+
+        for(int f = stack->depth - 1; f >= 0; f--)
+        {
+            la64_profiler_symbol_t *symbol = la64_profiler_symbolize(profiler, stack->pc[f]);
+
+            if(symbol != NULL)
+            {
+                fprintf(fp, "%s", symbol->name);
+            }
+            else
+            {
+                fprintf(fp, "0x%llx", (unsigned long long)stack->pc[f]);
+            }
+
+            fputc((f == 0) ? ' ' : ';', fp);
+        }
+
+        fprintf(fp, "%llu\n", (unsigned long long)stack->count);
+    }
+
+    fclose(fp);
+
+    return true;
+}
@@ -0,0 +1,330 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2026 cr4zyengineer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <la64vm/runner.h>
+#include <la64vm/machine.h>
+#include <la64vm/ioloop.h>
+
+static uint64_t runner_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool runner_add_job(la64_runner_t *runner,
+                           int *job_cap,
+                           const char *image_path,
+                           const char *console_path)
+{
+    if(runner->job_cnt == *job_cap)
+    {
+        int cap = *job_cap ? *job_cap * 2 : 64;
+        la64_job_t *job = realloc(runner->job, cap * sizeof(la64_job_t));
+
+        if(job == NULL)
+        {
+            return false;
+        }
+
+        runner->job = job;
+        *job_cap = cap;
+    }
+
+    la64_job_t *job = &(runner->job[runner->job_cnt]);
+    memset(job, 0, sizeof(la64_job_t));
+
+    job->image_path = strdup(image_path);
+    job->console_path = (console_path != NULL) ? strdup(console_path) : NULL;
+
+    if(job->image_path == NULL ||
+       (console_path != NULL && job->console_path == NULL))
+    {
+        free(job->image_path);
+        free(job->console_path);
+        return false;
+    }
+
+    runner->job_cnt++;
+
+    return true;
+}
+
+static void runner_job_timeout(void *ctx)
+{
+    la64_job_t *job = (la64_job_t *)ctx;
+
+    /* a guest that powered off just in time still counts as done */
+    if(atomic_load(&job->machine->core->stop))
+    {
+        return;
+    }
+
+    /* the worker sees it once la64_core_execute returns */
+    job->state = LA64_JOB_TIMEOUT;
+    la64_core_terminate(job->machine->core);
+}
+
+static void runner_run_job(la64_runner_t *runner,
+                           la64_job_t *job)
+{
+    uint64_t start = runner_now_ns();
+
+    job->machine = la64_machine_alloc(LA64_MACHINE_DEFAULT_MEMORY);
+
+    if(job->machine == NULL)
+    {
+        job->state = LA64_JOB_FAILED;
+        job->runtime_ns = runner_now_ns() - start;
+        return;
+    }
+
+    la64_machine_t *machine = job->machine;
+
+    /* consoles go to their own file, never to the shared terminal */
+    char console_spec[4096];
+
+    if(job->console_path != NULL)
+    {
+        snprintf(console_spec, sizeof(console_spec), "file:%s", job->console_path);
+    }
+    else
+    {
+        strcpy(console_spec, "null");
+    }
+
+#if defined(__linux__) || defined(__APPLE__)
+    /* no windows out of a batch */
+    machine->display->headless = true;
+#endif /* __linux__ || __APPLE__ */
+
+    la64_ioloop_source_t *timeout = NULL;
+
+    if(!la64_uart_attach(machine->uart, console_spec) ||
+       !la64_machine_boot(machine, job->image_path))
+    {
+        job->state = LA64_JOB_FAILED;
+        goto out_release_machine;
+    }
+
+    if(runner->timeout_ms != 0)
+    {
+        timeout = la64_ioloop_add_timer(machine->ioloop, runner_job_timeout, job);
+
+        if(timeout == NULL)
+        {
+            job->state = LA64_JOB_FAILED;
+            goto out_release_machine;
+        }
+
+        la64_ioloop_arm_timer(machine->ioloop, timeout, runner->timeout_ms * 1000000ULL, 0);
+    }
+
+    la64_core_execute(machine->core);
+
+    la64_ioloop_remove(machine->ioloop, timeout);
+
+    if(job->state != LA64_JOB_TIMEOUT)
+    {
+        job->state = LA64_JOB_DONE;
+        job->exit_code = machine->exit_code;
+    }
+
+out_release_machine:
+    la64_machine_dealloc(machine);
+    job->machine = NULL;
+    job->runtime_ns = runner_now_ns() - start;
+}
+
+static void *runner_worker(void *arg)
+{
+    la64_runner_t *runner = (la64_runner_t *)arg;
+
+    /* pulling jobs until the list runs dry, so long jobs dont hold up a whole batch */
+    while(1)
+    {
+        int i = atomic_fetch_add(&runner->next_job, 1);
+
+        if(i >= runner->job_cnt)
+        {
+            break;
+        }
+
+        runner_run_job(runner, &(runner->job[i]));
+    }
+
+    return NULL;
+}
+
+la64_runner_t *la64_runner_alloc(const char *job_list_path,
+                                 int worker_cnt,
+                                 uint64_t timeout_ms)
+{
+    FILE *list = fopen(job_list_path, "r");
+
+    if(list == NULL)
+    {
+        fprintf(stderr, "[runner] failed to open job list at path %s\n", job_list_path);
+        return NULL;
+    }
+
+    la64_runner_t *runner = calloc(1, sizeof(la64_runner_t));
+
+    if(runner == NULL)
+    {
+        fclose(list);
+        return NULL;
+    }
+
+    runner->worker_cnt = (worker_cnt > 0) ? worker_cnt : 1;
+    runner->timeout_ms = timeout_ms;
+    atomic_store(&runner->next_job, 0);
+
+    /* one job per line, <boot image> [<console file>], # starts a comment */
+    char line[8192];
+    int job_cap = 0;
+
+    while(fgets(line, sizeof(line), list) != NULL)
+    {
+        char *comment = strchr(line, '#');
+
+        if(comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        char *save = NULL;
+        char *image_path = strtok_r(line, " \t\r\n", &save);
+        char *console_path = strtok_r(NULL, " \t\r\n", &save);
+
+        if(image_path == NULL)
+        {
+            continue;
+        }
+
+        if(!runner_add_job(runner, &job_cap, image_path, console_path))
+        {
+            fclose(list);
+            la64_runner_dealloc(runner);
+            return NULL;
+        }
+    }
+
+    fclose(list);
+
+    return runner;
+}
+
+void la64_runner_dealloc(la64_runner_t *runner)
+{
+    for(int i = 0; i < runner->job_cnt; i++)
+    {
+        free(runner->job[i].image_path);
+        free(runner->job[i].console_path);
+    }
+
+    free(runner->job);
+    free(runner);
+}
+
+void la64_runner_run(la64_runner_t *runner)
+{
+    /* keeping the io loop up between jobs instead of respawning it for every machine */
+    la64_ioloop_t *loop = la64_ioloop_acquire();
+
+    int worker_cnt = (runner->worker_cnt < runner->job_cnt) ? runner->worker_cnt : runner->job_cnt;
+    pthread_t *worker = calloc(worker_cnt ? worker_cnt : 1, sizeof(pthread_t));
+
+    if(worker == NULL)
+    {
+        /* still getting through the list, just one job at a time */
+        runner_worker(runner);
+    }
+    else
+    {
+        int started = 0;
+
+        while(started < worker_cnt &&
+              pthread_create(&worker[started], NULL, runner_worker, runner) == 0)
+        {
+            started++;
+        }
+
+        /* without any thread this one does the work */
+        if(started == 0)
+        {
+            runner_worker(runner);
+        }
+
+        for(int i = 0; i < started; i++)
+        {
+            pthread_join(worker[i], NULL);
+        }
+
+        free(worker);
+    }
+
+    la64_ioloop_release(loop);
+}
+
+int la64_runner_report(la64_runner_t *runner,
+                       FILE *out)
+{
+    int failed = 0;
+
+    /* in job list order, whatever order they finished in */
+    for(int i = 0; i < runner->job_cnt; i++)
+    {
+        la64_job_t *job = &(runner->job[i]);
+        double ms = (double)job->runtime_ns / 1e6;
+
+        /* <index> <image> <result> <runtime ms>, one line per job */
+        switch(job->state)
+        {
+            case LA64_JOB_DONE:
+                fprintf(out, "%d %s exit %llu %.3f\n", i, job->image_path, (unsigned long long)job->exit_code, ms);
+                failed += (job->exit_code != 0);
+                break;
+            case LA64_JOB_TIMEOUT:
+                fprintf(out, "%d %s timeout %.3f\n", i, job->image_path, ms);
+                failed++;
+                break;
+            case LA64_JOB_FAILED:
+                fprintf(out, "%d %s failed %.3f\n", i, job->image_path, ms);
+                failed++;
+                break;
+            default:
+                fprintf(out, "%d %s pending %.3f\n", i, job->image_path, ms);
+                failed++;
+                break;
+        }
+    }
+
+    return failed;
+}